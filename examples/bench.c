@@ -0,0 +1,301 @@
+/*
+  bench.c — byte-stream parsing throughput, no MIDI hardware needed
+
+  Build:
+    macOS:   cc -O2 bench.c -framework CoreMIDI -o bench
+    Windows: cl /O2 bench.c
+    Linux:   cc -O2 bench.c -lasound -lpthread -o bench
+
+  Usage:
+    ./bench                -- 8 MB streams
+    ./bench 64             -- 64 MB streams
+
+  Compares the status-byte scan kernels (byte loop, portable 8-byte,
+  mm_scan_status with run-time dispatch) on one multi-MB SysEx body. Then
+  every byte-level decode path — mm_parser_feed, mm_ump_encoder_feed, and
+  mm_ump_decode over the encoder's output — on four synthetic streams: dense
+  channel data with a status per message, running status, one huge SysEx,
+  and SysEx with real-time clock interleaved. Input goes in 256-byte
+  packets; each figure is the fastest of the passes, so it is stable from
+  run to run. Last, the batch kernels (filter, channel remap, transpose,
+  velocity curve) against the same work done per mm_message, over an event
+  count matching the stream size. Add -DMM_NO_SIMD to see the parser and
+  kernels without the vector code.
+*/
+
+#define MINIMIDIO_IMPLEMENTATION
+#include "../minimidio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+static double now_s(void) {
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / (double)f.QuadPart;
+}
+#else
+#  include <time.h>
+static double now_s(void) {
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+#define REPEAT 20
+
+/* The loop the CoreMIDI backend used to run per packet. */
+static size_t scan_bytewise(const uint8_t* b, size_t n) {
+    size_t i = 0;
+    while (i < n && !(b[i] & 0x80)) i++;
+    return i;
+}
+
+static volatile size_t g_sink;
+
+static void bench_scan(const char* name, size_t (*fn)(const uint8_t*, size_t),
+                       const uint8_t* buf, size_t n)
+{
+    double t0 = now_s();
+    for (int r = 0; r < REPEAT; r++) g_sink += fn(buf, n);
+    double dt = now_s() - t0;
+    printf("  %-22s %8.2f GB/s\n", name, (double)n * REPEAT / dt / 1e9);
+}
+
+typedef struct { size_t messages, sysex_bytes; } counts;
+
+static void on_message(const mm_message* msg, void* ud) {
+    counts* c = (counts*)ud;
+    c->messages++;
+    if (msg->type == MM_SYSEX) c->sysex_bytes += msg->sysex_size;
+}
+
+/* ── Decode paths over synthetic streams ────────────────────────────────── */
+
+#define PACKET 256
+
+typedef enum { P_PARSER, P_UMP_ENCODE, P_UMP_DECODE } path;
+
+/* One pass of one path; returns seconds. ump is the encoder's output for
+   the stream (filled by the P_UMP_ENCODE pass, read by P_UMP_DECODE).     */
+static double run_path(path p, const uint8_t* buf, size_t n, uint8_t* sysex, size_t cap,
+                       uint32_t* ump, size_t* ump_words, counts* c)
+{
+    double t0 = now_s();
+    if (p == P_PARSER) {
+        mm_parser ps; mm_parser_init(&ps, sysex, cap);
+        for (size_t off = 0; off < n; off += PACKET)
+            mm_parser_feed(&ps, buf + off, (n - off < PACKET) ? n - off : PACKET, on_message, c);
+    } else if (p == P_UMP_ENCODE) {
+        mm_ump_encoder e; mm_ump_encoder_init(&e, MM_UMP_PROTOCOL_MIDI2, 0);
+        size_t w = 0;
+        for (size_t off = 0; off < n; off += PACKET) {
+            size_t k = (n - off < PACKET) ? n - off : PACKET, got = 0;
+            mm_ump_encoder_feed(&e, buf + off, k, ump + w, MM_UMP_WORDS_FOR_BYTES(k), &got);
+            w += got;
+        }
+        *ump_words = w;
+        c->messages += w;
+    } else {
+        mm_ump_decoder d; mm_ump_decoder_init(&d, sysex, cap);
+        mm_ump_decode(&d, ump, *ump_words, on_message, c);
+    }
+    return now_s() - t0;
+}
+
+/* Byte rates are of the MIDI 1.0 stream in every column, so they compare. */
+static void bench_paths(const char* name, const uint8_t* buf, size_t n,
+                        uint8_t* sysex, size_t cap, uint32_t* ump)
+{
+    printf("  %-22s", name);
+    size_t ump_words = 0;
+    for (int p = P_PARSER; p <= P_UMP_DECODE; p++) {
+        double best = 1e30;
+        counts c = { 0, 0 };
+        for (int r = 0; r < REPEAT; r++) {
+            counts pass = { 0, 0 };
+            double dt = run_path((path)p, buf, n, sysex, cap, ump, &ump_words, &pass);
+            if (dt < best) best = dt;
+            c = pass;
+        }
+        printf(" %8.0f %7.1f", (double)n / best / 1e6, (double)c.messages / best / 1e6);
+    }
+    printf("\n");
+}
+
+/* ── Batch kernels vs. the per-message loop ─────────────────────────────── */
+
+static const uint32_t k_types = MM_TYPE_BIT(MM_NOTE_ON) | MM_TYPE_BIT(MM_NOTE_OFF) |
+                                MM_TYPE_BIT(MM_PITCH_BEND);
+static const uint16_t k_chans = 0x00FF;
+
+static int is_channel(mm_message_type t) { return t >= MM_NOTE_OFF && t <= MM_PITCH_BEND; }
+static int is_note(mm_message_type t)    { return t >= MM_NOTE_OFF && t <= MM_POLY_PRESSURE; }
+
+static size_t loop_filter(mm_message* m, size_t n) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!(k_types & MM_TYPE_BIT(m[i].type))) continue;
+        if (is_channel(m[i].type) && !(k_chans & (1u << m[i].channel))) continue;
+        m[k++] = m[i];
+    }
+    return k;
+}
+static void loop_remap(mm_message* m, size_t n, const uint8_t map[16]) {
+    for (size_t i = 0; i < n; i++)
+        if (is_channel(m[i].type)) m[i].channel = map[m[i].channel] & 0x0F;
+}
+static void loop_transpose(mm_message* m, size_t n, int semis) {
+    for (size_t i = 0; i < n; i++) {
+        if (!is_note(m[i].type)) continue;
+        int v = m[i].data[0] + semis;
+        m[i].data[0] = (uint8_t)(v < 0 ? 0 : v > 127 ? 127 : v);
+    }
+}
+static void loop_velocity(mm_message* m, size_t n, const uint8_t lut[128]) {
+    for (size_t i = 0; i < n; i++)
+        if (m[i].type == MM_NOTE_ON && m[i].data[1]) m[i].data[1] = lut[m[i].data[1] & 0x7F];
+}
+
+typedef enum { K_FILTER, K_REMAP, K_TRANSPOSE, K_VELOCITY } kernel;
+typedef enum { F_MESSAGE, F_PACKED, F_BATCH } form;
+
+/* Runs one kernel REPEAT times on a fresh copy of the events each time;
+   only the kernel itself is timed. Returns M events/s.                    */
+static double bench_kernel(kernel k, form f, const mm_message* src, size_t n,
+                           const uint8_t map[16], const uint8_t lut[128])
+{
+    mm_message* m = NULL; mm_packed_message* pk = NULL; mm_event_batch b;
+    mm_filter flt; mm_filter_init(&flt, k_types, k_chans);
+    if (f == F_MESSAGE) m  = (mm_message*)malloc(n * sizeof(*m));
+    if (f == F_PACKED)  pk = (mm_packed_message*)malloc(n * sizeof(*pk));
+    if (f == F_BATCH)   mm_event_batch_init(&b, NULL, n);
+    double dt = 0;
+    for (int r = 0; r < REPEAT; r++) {
+        if (f == F_MESSAGE) memcpy(m, src, n * sizeof(*m));
+        if (f == F_PACKED)  mm_pack_messages(src, n, 0.0, pk);
+        if (f == F_BATCH)   { mm_event_batch_clear(&b); mm_event_batch_append(&b, src, n); }
+        int semis = (r & 1) ? -3 : 3;
+        double t0 = now_s();
+        switch (f) {
+        case F_MESSAGE:
+            if (k == K_FILTER)    g_sink += loop_filter(m, n);
+            if (k == K_REMAP)     loop_remap(m, n, map);
+            if (k == K_TRANSPOSE) loop_transpose(m, n, semis);
+            if (k == K_VELOCITY)  loop_velocity(m, n, lut);
+            break;
+        case F_PACKED:
+            if (k == K_FILTER)    g_sink += mm_packed_filter(pk, n, &flt);
+            if (k == K_REMAP)     mm_packed_remap(pk, n, map);
+            if (k == K_TRANSPOSE) mm_packed_transpose(pk, n, semis);
+            if (k == K_VELOCITY)  mm_packed_velocity(pk, n, lut);
+            break;
+        case F_BATCH:
+            if (k == K_FILTER)    g_sink += mm_event_batch_filter(&b, &flt);
+            if (k == K_REMAP)     mm_event_batch_remap(&b, map);
+            if (k == K_TRANSPOSE) mm_event_batch_transpose(&b, semis);
+            if (k == K_VELOCITY)  mm_event_batch_velocity(&b, lut);
+            break;
+        }
+        dt += now_s() - t0;
+    }
+    free(m); free(pk);
+    if (f == F_BATCH) mm_event_batch_uninit(&b);
+    return (double)n * REPEAT / dt / 1e6;
+}
+
+static void bench_kernels(size_t n) {
+    static const mm_message_type types[] = {
+        MM_NOTE_ON, MM_NOTE_OFF, MM_CONTROL_CHANGE, MM_POLY_PRESSURE, MM_PITCH_BEND, MM_NOTE_ON,
+    };
+    mm_message* src = (mm_message*)malloc(n * sizeof(*src));
+    if (!src) { fprintf(stderr, "out of memory\n"); return; }
+    uint32_t x = 2463534242u;   /* xorshift: irregular enough to defeat the branch predictor */
+    for (size_t i = 0; i < n; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        uint8_t status = (uint8_t)((types[x % 6] << 4) | ((x >> 8) & 0x0F));
+        src[i] = mm_make_message(status, (uint8_t)((x >> 12) & 0x7F), (uint8_t)((x >> 19) & 0x7F));
+        src[i].timestamp = (double)i * 1e-4;
+    }
+    uint8_t map[16], lut[128];
+    for (int c = 0; c < 16; c++)  map[c] = (uint8_t)(15 - c);
+    for (int v = 0; v < 128; v++) lut[v] = (uint8_t)(v * v / 127);
+
+    static const char* names[] = { "filter", "remap channels", "transpose", "velocity curve" };
+    printf("\nBatch kernels, %zu events, M events/s:\n", n);
+    printf("  %-22s %12s %12s %12s\n", "", "mm_message", "packed", "event batch");
+    for (int k = K_FILTER; k <= K_VELOCITY; k++)
+        printf("  %-22s %12.0f %12.0f %12.0f\n", names[k],
+               bench_kernel((kernel)k, F_MESSAGE, src, n, map, lut),
+               bench_kernel((kernel)k, F_PACKED,  src, n, map, lut),
+               bench_kernel((kernel)k, F_BATCH,   src, n, map, lut));
+    free(src);
+}
+
+int main(int argc, char** argv) {
+    size_t mb = (argc > 1) ? (size_t)atoi(argv[1]) : 8;
+    if (mb == 0) mb = 8;
+    size_t n = mb << 20;
+
+    /* One huge SysEx: F0, 7-bit payload, F7. */
+    uint8_t* sx = (uint8_t*)malloc(n);
+    /* Dense channel stream: a status every 64 messages, running status in
+       between, like a controller sweep from hardware.                      */
+    uint8_t* ch = (uint8_t*)malloc(n);
+    /* Dense channel data: note on/off with a status byte every message. */
+    uint8_t* dn = (uint8_t*)malloc(n);
+    /* SysEx with a clock every 48 bytes, as a dump sent during playback. */
+    uint8_t* rt = (uint8_t*)malloc(n);
+    uint8_t* asm_buf = (uint8_t*)malloc(n);
+    uint32_t* ump = (uint32_t*)malloc(MM_UMP_WORDS_FOR_BYTES(n) * sizeof(uint32_t));
+    if (!sx || !ch || !dn || !rt || !asm_buf || !ump) {
+        fprintf(stderr, "out of memory\n"); return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) sx[i] = (uint8_t)((i * 131u) & 0x7F);
+    sx[0] = 0xF0; sx[n - 1] = 0xF7;
+
+    size_t i = 0;
+    for (uint32_t k = 0; i + 3 <= n; k++) {
+        if (k % 64 == 0) ch[i++] = (uint8_t)(0xB0 | (k / 64 % 16));
+        if (i + 2 > n) break;
+        ch[i++] = (uint8_t)(k & 0x7F);
+        ch[i++] = (uint8_t)((k >> 7) & 0x7F);
+    }
+    for (; i < n; i++) ch[i] = 0xF8;
+
+    i = 0;
+    for (uint32_t k = 0; i + 3 <= n; k++) {
+        dn[i++] = (uint8_t)(((k & 1) ? 0x80 : 0x90) | (k % 16));
+        dn[i++] = (uint8_t)(36 + k % 48);
+        dn[i++] = (uint8_t)(1 + (k * 37) % 126);
+    }
+    for (; i < n; i++) dn[i] = 0xF8;
+
+    for (i = 0; i < n; i++) rt[i] = (i % 49 == 48) ? 0xF8 : (uint8_t)((i * 131u) & 0x7F);
+    rt[0] = 0xF0; rt[n - 1] = 0xF7;
+
+    printf("minimidio bench: %zu MB streams, %d passes, scan kernel: %s\n\n",
+           mb, REPEAT, mm_scan_backend());
+
+    printf("Find the F7 in a %zu MB SysEx body:\n", mb);
+    bench_scan("byte loop",             scan_bytewise,        sx + 1, n - 1);
+    bench_scan("8 bytes/step (SWAR)",   mm__scan_status_swar, sx + 1, n - 1);
+    bench_scan("mm_scan_status",        mm_scan_status,       sx + 1, n - 1);
+
+    printf("\nDecode paths, %d-byte packets, MB/s of MIDI 1.0 bytes and M events/s\n"
+           "(encoder events are UMP words out):\n", PACKET);
+    printf("  %-22s %16s %16s %16s\n", "", "mm_parser_feed", "ump encode", "ump decode");
+    bench_paths("dense channel",        dn, n, NULL,    0, ump);
+    bench_paths("running-status CCs",   ch, n, NULL,    0, ump);
+    bench_paths("huge sysex",           sx, n, asm_buf, n, ump);
+    bench_paths("sysex + clock",        rt, n, asm_buf, n, ump);
+
+    bench_kernels(n / 8);
+
+    free(sx); free(ch); free(dn); free(rt); free(asm_buf); free(ump);
+    return (int)(g_sink & 0);
+}
@@ -0,0 +1,111 @@
+/*
+  clock_out.c — act as MIDI clock master: START, then clock at a set tempo
+
+  Build:
+    Linux:   cc clock_out.c -lasound -lpthread -o clock_out
+    (mm_clock_master needs the ALSA sequencer; on macOS / Windows it
+     reports MM_NO_BACKEND)
+
+  Usage:
+    ./clock_out              -- virtual output "clock-master", 120 BPM
+    ./clock_out 96.5         -- virtual output at 96.5 BPM
+    ./clock_out 128 2        -- output[2] at 128 BPM
+
+  Connect a synth, drum machine or DAW (set to external sync) to us. The
+  kernel's queue timer sends the clocks; this process only wakes every
+  50 ms to schedule the next ones (half the window lasts 60 ms at 1000 BPM). Every 8 bars the tempo steps by 4 BPM
+  to show that changes land on a clock boundary. Ctrl-C sends STOP.
+*/
+
+#define MINIMIDIO_IMPLEMENTATION
+#include "../minimidio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  define mm_sleep_ms(ms) Sleep(ms)
+#else
+#  include <unistd.h>
+#  define mm_sleep_ms(ms) usleep((ms)*1000)
+#endif
+
+#include <signal.h>
+
+static volatile int g_running = 1;
+#ifdef _WIN32
+static BOOL WINAPI ctrl_handler(DWORD e) {
+    if (e == CTRL_C_EVENT || e == CTRL_BREAK_EVENT) { g_running = 0; return TRUE; }
+    return FALSE;
+}
+static void setup_ctrl_c(void) { SetConsoleCtrlHandler(ctrl_handler, TRUE); }
+#else
+static void sig_handler(int s) { (void)s; g_running = 0; }
+static void setup_ctrl_c(void) { signal(SIGINT, sig_handler); signal(SIGTERM, sig_handler); }
+#endif
+
+int main(int argc, char* argv[]) {
+    double bpm = (argc > 1) ? atof(argv[1]) : 120.0;
+    if (bpm < 10.0 || bpm > 1000.0) bpm = 120.0;
+
+    setup_ctrl_c();
+
+    mm_context ctx;
+    mm_result r = mm_context_init(&ctx, "clock-master");
+    if (r != MM_SUCCESS) {
+        fprintf(stderr, "mm_context_init: %s\n", mm_result_string(r));
+        return 1;
+    }
+
+    mm_device out;
+    if (argc > 2) {
+        uint32_t idx = (uint32_t)atoi(argv[2]);
+        char name[256] = "";
+        mm_out_name(&ctx, idx, name, sizeof(name));
+        printf("Output      : [%u] %s\n", idx, name);
+        r = mm_out_open(&ctx, &out, idx);
+    } else {
+        printf("Output      : virtual \"%s\"\n", ctx.name);
+        r = mm_out_open_virtual(&ctx, &out);
+    }
+    if (r != MM_SUCCESS) {
+        fprintf(stderr, "open: %s\n", mm_result_string(r));
+        mm_context_uninit(&ctx);
+        return 1;
+    }
+
+    mm_clock_master clk;
+    r = mm_clock_master_init(&clk, &out, bpm);
+    if (r != MM_SUCCESS) {
+        fprintf(stderr, "mm_clock_master_init: %s\n", mm_result_string(r));
+        mm_out_close(&out);
+        mm_context_uninit(&ctx);
+        return 1;
+    }
+
+    printf("Tempo       : %.2f BPM, %u clocks scheduled ahead\n\n", bpm, clk.window);
+    mm_clock_master_start(&clk);
+
+    uint32_t next_step = 24 * 4 * 8;   /* 8 bars of 4/4, in clocks */
+    while (g_running) {
+        mm_clock_master_refill(&clk);
+        /* song_clock runs a window ahead of what has been played. */
+        uint32_t played = clk.song_clock > clk.window ? clk.song_clock - clk.window : 0;
+        if (played >= next_step) {
+            next_step += 24 * 4 * 8;
+            bpm += 4.0;
+            mm_clock_master_set_tempo(&clk, bpm);
+        }
+        printf("\r  bar %4u  beat %u  %.2f BPM   ", played / 96 + 1, played / 24 % 4 + 1, clk.bpm);
+        fflush(stdout);
+        mm_sleep_ms(50);
+    }
+
+    printf("\nStopping...\n");
+    mm_clock_master_stop(&clk);
+    mm_clock_master_uninit(&clk);
+    mm_out_close(&out);
+    mm_context_uninit(&ctx);
+    return 0;
+}
@@ -15,12 +15,14 @@
   In your DAW, enable MIDI clock output and point it at this client.
 
   What it handles:
-    MM_CLOCK         — 24 pulses per beat; used to estimate BPM
+    MM_CLOCK         — 24 pulses per beat; mm_clock_tracker turns them
+                       into a steady BPM, beat position and lock quality
     MM_START         — DAW started from bar 1
     MM_CONTINUE      — DAW resumed from current position
     MM_STOP          — DAW stopped
     MM_SONG_POSITION — DAW jumped / rewound; decoded beat count
-    MM_MTC_QUARTER_FRAME — accumulates into full SMPTE timecode frame
+    MM_MTC_QUARTER_FRAME — mm_mtc_chaser tracks timecode, forward or
+                       reverse, and full-frame locates (SysEx)
     MM_ACTIVE_SENSE  — DAW keepalive (silently tracked)
 */
 
@@ -57,13 +59,9 @@ static void setup_ctrl_c(void) { signal(SIGINT, sig_handler); signal(SIGTERM, si
 /* ── Transport state ─────────────────────────────────────────────────────── */
 
 typedef struct {
-    volatile int      running;
-    volatile int      clock_count;    /* 0–23 within current beat */
-    volatile int      beat;           /* beats since last Start   */
-    volatile double   last_clock_ts;
-    volatile double   bpm;
+    mm_clock_tracker  clock;          /* tempo + position; read from main */
     volatile uint32_t song_pos;       /* most recent SPP (beats)  */
-    mm_mtc_state      mtc;
+    mm_mtc_chaser     mtc;            /* timecode; read from main     */
 } daw_state;
 
 static daw_state g_state;
@@ -72,53 +70,36 @@ static daw_state g_state;
 
 static void on_midi(mm_device* dev, const mm_message* msg, void* ud) {
     daw_state* s = (daw_state*)ud;
+    mm_clock_info ci;
     (void)dev;
 
+    /* Clock, transport, SPP and reset all feed the tracker. */
+    mm_clock_tracker_push(&s->clock, msg);
+    /* Quarter frames and full-frame SysEx feed the chaser. */
+    mm_mtc_chaser_push(&s->mtc, msg);
+
     switch (msg->type) {
 
         case MM_START:
-            s->running     = 1;
-            s->clock_count = 0;
-            s->beat        = 0;
-            s->song_pos    = 0;
+            s->song_pos = 0;
             printf("\n[TRANSPORT] START\n");
             fflush(stdout);
             break;
 
         case MM_CONTINUE:
-            s->running = 1;
-            printf("\n[TRANSPORT] CONTINUE  (beat %d, SPP %u)\n",
-                   s->beat, s->song_pos);
+            mm_clock_tracker_read(&s->clock, 0, &ci);
+            printf("\n[TRANSPORT] CONTINUE  (beat %.2f, SPP %u)\n",
+                   ci.position, s->song_pos);
             fflush(stdout);
             break;
 
         case MM_STOP:
-            s->running = 0;
-            printf("\n[TRANSPORT] STOP  (beat %d, BPM %.2f)\n",
-                   s->beat, s->bpm);
+            mm_clock_tracker_read(&s->clock, 0, &ci);
+            printf("\n[TRANSPORT] STOP  (beat %.2f, BPM %.2f)\n",
+                   ci.position, ci.bpm);
             fflush(stdout);
             break;
 
-        case MM_CLOCK:
-            if (!s->running) break;
-
-            /* BPM from inter-clock interval (24 clocks per quarter note) */
-            if (s->last_clock_ts > 0.0) {
-                double interval = msg->timestamp - s->last_clock_ts;
-                if (interval > 0.0)
-                    s->bpm = 60.0 / (interval * 24.0);
-            }
-            s->last_clock_ts = msg->timestamp;
-
-            if (++s->clock_count >= 24) {
-                s->clock_count = 0;
-                s->beat++;
-                printf("\r  Beat %-6d  BPM: %6.2f  SPP: %-6u   ",
-                       s->beat, s->bpm, s->song_pos);
-                fflush(stdout);
-            }
-            break;
-
         case MM_SONG_POSITION:
             s->song_pos = msg->song_position;
             /* 1 SPP beat = 1 MIDI beat = 6 clocks = 1/16 note
@@ -130,29 +111,12 @@ static void on_midi(mm_device* dev, const mm_message* msg, void* ud) {
             fflush(stdout);
             break;
 
-        case MM_MTC_QUARTER_FRAME: {
-            mm_mtc_frame frame;
-            if (mm_mtc_push(&s->mtc, msg->data[0], &frame)) {
-                printf("\n[MTC] %02d:%02d:%02d:%02d  %s  (%.3f s)\n",
-                       frame.hours, frame.minutes,
-                       frame.seconds, frame.frames,
-                       mm_mtc_rate_string(frame.rate),
-                       mm_mtc_to_seconds(&frame));
-                fflush(stdout);
-            }
-            break;
-        }
-
         case MM_ACTIVE_SENSE:
             /* DAW is alive — silently ignore to avoid flooding */
             break;
 
         case MM_RESET:
-            s->running     = 0;
-            s->clock_count = 0;
-            s->beat        = 0;
-            s->song_pos    = 0;
-            s->bpm         = 0;
+            s->song_pos = 0;
             printf("\n[RESET]\n");
             fflush(stdout);
             break;
@@ -202,6 +166,8 @@ int main(int argc, char* argv[]) {
     }
 
     memset(&g_state, 0, sizeof(g_state));
+    mm_clock_tracker_init(&g_state.clock);
+    mm_mtc_chaser_init(&g_state.mtc);
 
     mm_device dev;
     r = mm_in_open(&ctx, &dev, port_idx, on_midi, &g_state);
@@ -224,7 +190,28 @@ int main(int argc, char* argv[]) {
            ctx.name);
     printf("Handles: CLOCK  START  STOP  CONTINUE  SONG-POSITION  MTC  RESET\n\n");
 
-    while (g_running) mm_sleep_ms(100);
+    /* The tracker and chaser are safe to read from any thread; mm_in_time
+       puts "now" on the timestamps' clock so a stall shows up at once.   */
+    while (g_running) {
+        mm_clock_info ci;
+        mm_mtc_chase_info mi;
+        const double now = mm_in_time(&dev);
+        mm_clock_tracker_read(&g_state.clock, now, &ci);
+        mm_mtc_chaser_read(&g_state.mtc, now, &mi);
+        if (ci.locked)
+            printf("\r  %s  Beat %8.2f  BPM: %6.2f  jitter %4.1f ms  lock %3.0f%%  %s   ",
+                   ci.running ? "PLAY" : "STOP", ci.position, ci.bpm,
+                   ci.jitter * 1e3, ci.confidence * 100.0,
+                   ci.dropout ? "NO CLOCK" : "        ");
+        else if (mi.locked)
+            printf("\r  MTC %02d:%02d:%02d:%02d  %-15s  %s   ",
+                   mi.frame.hours, mi.frame.minutes, mi.frame.seconds, mi.frame.frames,
+                   mm_mtc_rate_string(mi.frame.rate),
+                   mi.dropout ? "NO MTC " : mi.direction > 0 ? "PLAY   "
+                              : mi.direction < 0 ? "REVERSE" : "STOP   ");
+        fflush(stdout);
+        mm_sleep_ms(100);
+    }
     printf("\nStopping...\n");
 
     mm_in_stop(&dev);
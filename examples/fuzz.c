@@ -0,0 +1,418 @@
+/*
+  fuzz.c — fuzz harness for every decoder that builds on this platform
+
+  Build:
+    libFuzzer: clang -g -O1 -fsanitize=fuzzer,address,undefined -DMM_FUZZ_LIBFUZZER \
+                   fuzz.c -lasound -lpthread -o fuzz
+    AFL++:     afl-clang-fast -g -O1 fuzz.c -lasound -lpthread -o fuzz
+    plain:     cc -g -O1 -fsanitize=address,undefined fuzz.c -lasound -lpthread -o fuzz
+    (macOS: -framework CoreMIDI instead of -lasound -lpthread; Windows: cl fuzz.c)
+
+  Usage:
+    ./fuzz corpus/                 -- libFuzzer build
+    afl-fuzz -i seeds -o out -- ./fuzz @@
+    ./fuzz file...                 -- run the given inputs once
+    ./fuzz                         -- one input from stdin
+    ./fuzz -random 100000          -- generated MIDI-ish inputs, no fuzzer needed
+
+  Every input runs through all targets below. A broken invariant prints what
+  failed and aborts, which both fuzzers record as a crash.
+
+    parser     mm_parser_feed, fed whole and in input-derived chunks (the way
+               CoreMIDI packets arrive): both must emit the same messages,
+               and every message must be well formed
+    short      mm__decode / mm__encode, the WinMM short-message path: encode
+               must give back the wire bytes decode was given
+    ump-bytes  mm_ump_encoder → mm_ump_decoder against the parser, both
+               protocols, words split at arbitrary points
+    ump-words  the input as raw UMP words through mm_ump_decode
+    alsa       (Linux) the input as sequencer events through the receive
+               thread's decoder, and as UMP events if alsa-lib has them
+*/
+
+#define MINIMIDIO_IMPLEMENTATION
+#include "../minimidio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void fail(const char* target, const char* what) {
+    fprintf(stderr, "fuzz: %s: %s\n", target, what);
+    abort();
+}
+#define CHECK(target, cond) do { if (!(cond)) fail(target, #cond); } while (0)
+
+/* ── Message log: a flat byte record of what a decoder emitted ──────────── */
+
+typedef struct msg_log {
+    uint8_t* buf;
+    size_t   len, cap;
+    size_t   count, sysex_count;
+    int      short_only;   /* skip SysEx (ump-bytes: see there) */
+    int      note_off_v0;  /* write note-on velocity 0 as note-off */
+} msg_log;
+
+static void log_put(msg_log* l, const void* p, size_t n) {
+    if (l->len + n > l->cap) {
+        l->cap = (l->len + n) * 2 + 256;
+        l->buf = (uint8_t*)realloc(l->buf, l->cap);
+        if (!l->buf) fail("log", "out of memory");
+    }
+    memcpy(l->buf + l->len, p, n);
+    l->len += n;
+}
+
+/* Whatever emitted it, a message must look like this. */
+static void check_message(const char* target, const mm_message* m) {
+    if (m->type == MM_SYSEX) {
+        CHECK(target, m->sysex != NULL && m->sysex_size >= 2);
+        CHECK(target, m->sysex[0] == 0xF0 && m->sysex[m->sysex_size - 1] == 0xF7);
+        for (size_t i = 1; i + 1 < m->sysex_size; i++) CHECK(target, m->sysex[i] < 0x80);
+        return;
+    }
+    uint8_t b[3];
+    CHECK(target, mm__encode(m, b) > 0);
+    CHECK(target, m->channel < 16);
+    CHECK(target, m->data[0] < 0x80 && m->data[1] < 0x80);
+}
+
+static void on_log(const mm_message* m, void* ud) {
+    msg_log* l = (msg_log*)ud;
+    l->count++;
+    if (m->type == MM_SYSEX) {
+        l->sysex_count++;
+        if (l->short_only) return;
+        uint32_t n = (uint32_t)m->sysex_size;
+        log_put(l, &n, sizeof(n));
+        log_put(l, m->sysex, n);
+        return;
+    }
+    uint8_t b[4] = { 0, 0, 0, 0 };
+    mm__encode(m, b);
+    if (l->note_off_v0 && (b[0] & 0xF0) == 0x90 && b[2] == 0) b[0] = (uint8_t)(0x80 | (b[0] & 0x0F));
+    b[3] = (uint8_t)m->port_index;
+    log_put(l, b, 4);
+}
+
+typedef struct checked_log { msg_log log; const char* target; } checked_log;
+
+static void on_checked(const mm_message* m, void* ud) {
+    checked_log* c = (checked_log*)ud;
+    check_message(c->target, m);
+    on_log(m, &c->log);
+}
+
+/* Chunk sizes from the input itself, so a fuzzer can steer the splits.
+   xorshift keeps it deterministic per input.                              */
+typedef struct splitter { uint32_t x; } splitter;
+static splitter split_init(const uint8_t* d, size_t n) {
+    splitter s; s.x = 2166136261u ^ (uint32_t)n;
+    for (size_t i = 0; i < n && i < 16; i++) s.x = (s.x ^ d[i]) * 16777619u;
+    if (!s.x) s.x = 1;
+    return s;
+}
+static size_t split_next(splitter* s, size_t left) {
+    s->x ^= s->x << 13; s->x ^= s->x >> 17; s->x ^= s->x << 5;
+    size_t k = (s->x & 3) ? (s->x >> 8) % 8 + 1 : (s->x >> 8) % 300 + 1;
+    return k < left ? k : left;
+}
+
+/* ── parser ────────────────────────────────────────────────────────────── */
+
+static void fuzz_parser(const uint8_t* d, size_t n, uint8_t* sysex, size_t cap) {
+    checked_log whole = { { NULL, 0, 0, 0, 0, 0, 0 }, "parser" };
+    checked_log split = { { NULL, 0, 0, 0, 0, 0, 0 }, "parser" };
+    mm_parser p;
+
+    mm_parser_init(&p, sysex, cap);
+    mm_parser_feed(&p, d, n, on_checked, &whole);
+
+    mm_parser_init(&p, sysex, cap);
+    splitter s = split_init(d, n);
+    for (size_t off = 0; off < n; ) {
+        size_t k = split_next(&s, n - off);
+        mm_parser_feed(&p, d + off, k, on_checked, &split);
+        off += k;
+    }
+    CHECK("parser", whole.log.count == split.log.count);
+    CHECK("parser", whole.log.len == split.log.len);
+    CHECK("parser", whole.log.len == 0 || !memcmp(whole.log.buf, split.log.buf, whole.log.len));
+
+    /* No buffer: only SysEx complete within one feed survives. */
+    checked_log none = { { NULL, 0, 0, 0, 0, 0, 0 }, "parser" };
+    mm_parser_init(&p, NULL, 0);
+    mm_parser_feed(&p, d, n, on_checked, &none);
+    CHECK("parser", none.log.count <= whole.log.count);
+
+    free(whole.log.buf); free(split.log.buf); free(none.log.buf);
+}
+
+/* ── short (WinMM) ─────────────────────────────────────────────────────── */
+
+static void fuzz_short(const uint8_t* d, size_t n) {
+    for (size_t i = 0; i + 3 <= n; i += 3) {
+        /* A short message from the driver carries 7-bit data bytes. */
+        uint8_t st = (uint8_t)(d[i] | 0x80), d1 = d[i + 1] & 0x7F, d2 = d[i + 2] & 0x7F;
+        const mm__status_info si = mm__status_table[st];
+        mm_message m = mm__decode(st, d1, d2);
+        uint8_t b[3];
+        int len = mm__encode(&m, b);
+        if (!si.type || (si.flags & MM__ST_SYSEX)) continue;
+        CHECK("short", len == 1 + si.len);
+        CHECK("short", b[0] == st);
+        if (si.len > 0) CHECK("short", b[1] == d1);
+        if (si.len > 1) CHECK("short", b[2] == d2);
+    }
+}
+
+/* ── ump-bytes ─────────────────────────────────────────────────────────── */
+
+/* The encoder closes a SysEx cut short by a status byte (its packets are
+   already out); the parser drops it. So SysEx is compared by count only. */
+static void fuzz_ump_bytes(const uint8_t* d, size_t n, uint8_t* sysex, size_t cap) {
+    for (int proto = MM_UMP_PROTOCOL_MIDI1; proto <= MM_UMP_PROTOCOL_MIDI2; proto++) {
+        const uint8_t group = n ? (uint8_t)(d[0] & 0x0F) : 0;
+        checked_log ref = { { NULL, 0, 0, 0, 0, 1, proto == MM_UMP_PROTOCOL_MIDI2 }, "ump-bytes" };
+        checked_log out = { { NULL, 0, 0, 0, 0, 1, 0 }, "ump-bytes" };
+        mm_parser p;
+        mm_parser_init(&p, NULL, 0);
+        p.port_index = group;
+        mm_parser_feed(&p, d, n, on_checked, &ref);
+
+        mm_ump_encoder e;
+        mm_ump_encoder_init(&e, (mm_ump_protocol)proto, group);
+        mm_ump_decoder dec;
+        mm_ump_decoder_init(&dec, sysex, cap);
+        uint32_t* words = (uint32_t*)malloc(MM_UMP_WORDS_FOR_BYTES(n) * sizeof(uint32_t) + 16);
+        if (!words) fail("ump-bytes", "out of memory");
+        size_t pending = 0;
+        splitter s = split_init(d, n);
+        for (size_t off = 0; off < n; ) {
+            size_t k = split_next(&s, n - off), w = 0;
+            CHECK("ump-bytes", mm_ump_encoder_feed(&e, d + off, k, words + pending,
+                                                   MM_UMP_WORDS_FOR_BYTES(k), &w) == MM_SUCCESS);
+            CHECK("ump-bytes", w <= MM_UMP_WORDS_FOR_BYTES(k));
+            for (size_t j = pending; j < pending + w; ) {
+                CHECK("ump-bytes", MM_UMP_GROUP(words[j]) == group);
+                j += mm_ump_words(words[j]);
+            }
+            pending += w;
+            /* Decode up to an arbitrary word; a packet cut there waits. */
+            size_t upto = pending ? split_next(&s, pending + 1) % (pending + 1) : 0;
+            size_t used = mm_ump_decode(&dec, words, upto, on_checked, &out);
+            CHECK("ump-bytes", used <= upto && upto - used < 4);
+            memmove(words, words + used, (pending - used) * sizeof(uint32_t));
+            pending -= used;
+            off += k;
+        }
+        CHECK("ump-bytes", mm_ump_decode(&dec, words, pending, on_checked, &out) == pending);
+        CHECK("ump-bytes", ref.log.len == out.log.len);
+        CHECK("ump-bytes", ref.log.len == 0 || !memcmp(ref.log.buf, out.log.buf, ref.log.len));
+        CHECK("ump-bytes", out.log.sysex_count <= ref.log.sysex_count + 1 + n / 2);
+        free(words); free(ref.log.buf); free(out.log.buf);
+    }
+}
+
+/* ── ump-words ─────────────────────────────────────────────────────────── */
+
+typedef struct reencode { const char* target; } reencode;
+
+/* A decoded short message must survive mm_ump_from_message → decode. */
+static void on_reencode(const mm_message* m, void* ud) {
+    const char* target = ((reencode*)ud)->target;
+    check_message(target, m);
+    if (m->type == MM_SYSEX) return;
+    for (int proto = MM_UMP_PROTOCOL_MIDI1; proto <= MM_UMP_PROTOCOL_MIDI2; proto++) {
+        uint32_t w[4];
+        size_t k = mm_ump_from_message(m, (mm_ump_protocol)proto, w, 4);
+        CHECK(target, k == 1 || k == 2);
+        msg_log a = { NULL, 0, 0, 0, 0, 0, proto == MM_UMP_PROTOCOL_MIDI2 };
+        msg_log b = { NULL, 0, 0, 0, 0, 0, 0 };
+        on_log(m, &a);
+        mm_ump_decoder dec;
+        mm_ump_decoder_init(&dec, NULL, 0);
+        CHECK(target, mm_ump_decode(&dec, w, k, on_log, &b) == k);
+        CHECK(target, a.len == b.len && !memcmp(a.buf, b.buf, a.len));
+        free(a.buf); free(b.buf);
+    }
+}
+
+static void fuzz_ump_words(const uint8_t* d, size_t n, uint8_t* sysex, size_t cap) {
+    size_t nw = n / 4;
+    uint32_t* w = (uint32_t*)malloc(nw * sizeof(uint32_t) + 4);
+    if (!w) fail("ump-words", "out of memory");
+    memcpy(w, d, nw * sizeof(uint32_t));
+    mm_ump_decoder dec;
+    mm_ump_decoder_init(&dec, sysex, cap);
+    reencode r = { "ump-words" };
+    size_t used = mm_ump_decode(&dec, w, nw, on_reencode, &r);
+    CHECK("ump-words", used <= nw && nw - used < 4);
+    if (used < nw) CHECK("ump-words", mm_ump_words(w[used]) > nw - used);
+    free(w);
+}
+
+/* ── alsa ──────────────────────────────────────────────────────────────── */
+
+#if defined(MM_BACKEND_ALSA)
+/* Sequencer SysEx is passed through as the sender chunked it, so only
+   the framing and the size cap are checked, not the body.                */
+static void on_alsa(mm_device* dev, const mm_message* m, void* ud) {
+    (void)ud;
+    if (m->type != MM_SYSEX) { check_message("alsa", m); return; }
+    CHECK("alsa", m->sysex_size >= 2 && m->sysex_size <= dev->ctx->config.sysex_size);
+    CHECK("alsa", m->sysex[0] == 0xF0 && m->sysex[m->sysex_size - 1] == 0xF7);
+}
+static void on_alsa_ump(mm_device* dev, const uint32_t* w, uint32_t n, double t, void* ud) {
+    (void)dev; (void)t; (void)ud;
+    CHECK("alsa", n == mm_ump_words(w[0]));
+}
+
+/* 16-byte records: type selector, source, then the event payload. SysEx
+   chunks point back into the input, so chunked reassembly is exercised. */
+static void fuzz_alsa(const uint8_t* d, size_t n) {
+    static const unsigned char types[] = {
+        SND_SEQ_EVENT_NOTEON, SND_SEQ_EVENT_NOTEOFF, SND_SEQ_EVENT_KEYPRESS,
+        SND_SEQ_EVENT_CONTROLLER, SND_SEQ_EVENT_PGMCHANGE, SND_SEQ_EVENT_CHANPRESS,
+        SND_SEQ_EVENT_PITCHBEND, SND_SEQ_EVENT_CLOCK, SND_SEQ_EVENT_START,
+        SND_SEQ_EVENT_CONTINUE, SND_SEQ_EVENT_STOP, SND_SEQ_EVENT_SONGPOS,
+        SND_SEQ_EVENT_QFRAME, SND_SEQ_EVENT_SONGSEL, SND_SEQ_EVENT_SENSING,
+        SND_SEQ_EVENT_TUNE_REQUEST, SND_SEQ_EVENT_RESET, SND_SEQ_EVENT_SYSEX,
+        SND_SEQ_EVENT_SYSEX, SND_SEQ_EVENT_SYSEX, SND_SEQ_EVENT_ECHO,
+    };
+    mm_context_config cfg = mm_context_config_init();
+    cfg.sysex_size = 512;
+    mm_context ctx;
+    if (mm__context_setup(&ctx, &cfg) != MM_SUCCESS) fail("alsa", "context setup");
+    mm_device dev;
+    memset(&dev, 0, sizeof(dev));
+    dev.ctx = &ctx; dev.callback = on_alsa; dev.is_input = dev.is_open = 1;
+
+    for (size_t i = 0; i + 16 <= n; i += 16) {
+        const uint8_t* r = d + i;
+        snd_seq_event_t ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.type = types[r[0] % sizeof(types)];
+        ev.source.client = r[1] & 3;
+        ev.source.port   = r[2] & 1;
+        if (ev.type == SND_SEQ_EVENT_SYSEX) {
+            size_t off = ((size_t)r[3] << 8 | r[4]) % (n + 1);
+            size_t len = r[5] % 64;
+            if (len > n - off) len = n - off;
+            ev.data.ext.ptr = (void*)(d + off);
+            ev.data.ext.len = (unsigned int)len;
+        } else {
+            ev.data.note.channel  = r[3];
+            ev.data.note.note     = r[4];
+            ev.data.note.velocity = r[5];
+            memcpy(&ev.data.control.param, r + 8, 4);
+            memcpy(&ev.data.control.value, r + 12, 4);
+            ev.data.control.channel = r[3];
+        }
+        mm__alsa_deliver(&dev, 0, &ev);
+    }
+    mm__free(&ctx, dev.al.sysex); dev.al.sysex = NULL;
+
+#if defined(MM__ALSA_UMP)
+    /* UMP client input: decoded for an mm_callback, raw for a UMP one. */
+    for (int raw = 0; raw < 2; raw++) {
+        dev.ump_callback = raw ? on_alsa_ump : NULL;
+        for (size_t i = 0; i + 16 <= n; i += 16) {
+            snd_seq_ump_event_t ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.flags = SND_SEQ_EVENT_UMP;
+            memcpy(ev.ump, d + i, 16);
+            mm__alsa_deliver_ump(&dev, 0, &ev);
+        }
+    }
+    mm__free(&ctx, dev.al.ump); dev.al.ump = NULL;
+#endif
+}
+#endif
+
+/* ── entry points ──────────────────────────────────────────────────────── */
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    /* Big enough that the split and whole feeds never differ by overflow. */
+    size_t cap = size + 2;
+    uint8_t* sysex = (uint8_t*)malloc(cap);
+    if (!sysex) return 0;
+    fuzz_parser(data, size, sysex, cap);
+    fuzz_short(data, size);
+    fuzz_ump_bytes(data, size, sysex, cap);
+    fuzz_ump_words(data, size, sysex, cap);
+#if defined(MM_BACKEND_ALSA)
+    fuzz_alsa(data, size);
+#endif
+    free(sysex);
+    return 0;
+}
+
+#ifndef MM_FUZZ_LIBFUZZER
+
+static uint8_t* read_all(FILE* f, size_t* n) {
+    size_t cap = 4096, len = 0;
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    size_t got;
+    while (buf && (got = fread(buf + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) { cap *= 2; buf = (uint8_t*)realloc(buf, cap); }
+    }
+    *n = len;
+    return buf;
+}
+
+/* MIDI-shaped noise: mostly data bytes, with statuses, SysEx framing and
+   real-time bytes mixed in often enough to hit every parser state.       */
+static size_t random_input(uint8_t* buf, size_t max, uint32_t* x) {
+    *x ^= *x << 13; *x ^= *x >> 17; *x ^= *x << 5;
+    size_t n = *x % max;
+    for (size_t i = 0; i < n; i++) {
+        *x ^= *x << 13; *x ^= *x >> 17; *x ^= *x << 5;
+        uint32_t r = *x;
+        switch (r % 16) {
+        case 0:  buf[i] = 0xF0; break;
+        case 1:  buf[i] = 0xF7; break;
+        case 2:  buf[i] = (uint8_t)(0xF8 + (r >> 8) % 8); break;
+        case 3:
+        case 4:  buf[i] = (uint8_t)(0x80 | (r >> 8)); break;
+        case 5:  buf[i] = (uint8_t)(r >> 8); break;
+        default: buf[i] = (uint8_t)((r >> 8) & 0x7F); break;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 && strcmp(argv[1], "-random") == 0) {
+        long runs = atol(argv[2]);
+        uint8_t buf[4096];
+        uint32_t x = 0x9E3779B9u;
+        for (long r = 0; r < runs; r++) {
+            size_t n = random_input(buf, sizeof(buf), &x);
+            LLVMFuzzerTestOneInput(buf, n);
+        }
+        printf("fuzz: %ld random inputs, no failures\n", runs);
+        return 0;
+    }
+    if (argc < 2) {
+        size_t n; uint8_t* buf = read_all(stdin, &n);
+        if (!buf) return 1;
+        LLVMFuzzerTestOneInput(buf, n);
+        free(buf);
+        return 0;
+    }
+    for (int a = 1; a < argc; a++) {
+        FILE* f = fopen(argv[a], "rb");
+        if (!f) { fprintf(stderr, "fuzz: cannot open %s\n", argv[a]); return 1; }
+        size_t n; uint8_t* buf = read_all(f, &n);
+        fclose(f);
+        if (!buf) return 1;
+        LLVMFuzzerTestOneInput(buf, n);
+        free(buf);
+    }
+    return 0;
+}
+
+#endif
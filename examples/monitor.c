@@ -115,32 +115,37 @@ int main(int argc, char* argv[]) {
 
     printf("Client name : \"%s\"\n\n", ctx.name);
 
+    /* One enumeration pass for the whole listing (and the open below). */
+    mm_port_registry reg;
+    r = mm_registry_init(&ctx, &reg);
+    if (r != MM_SUCCESS) {
+        fprintf(stderr, "mm_registry_init: %s\n", mm_result_string(r));
+        mm_context_uninit(&ctx);
+        return 1;
+    }
+
     printf("=== MIDI Inputs ===\n");
-    uint32_t in_count = mm_in_count(&ctx);
+    uint32_t in_count = reg.in_count;
     if (in_count == 0) {
         printf("  (none)\n");
     } else {
-        for (uint32_t i = 0; i < in_count; i++) {
-            char name[256];
-            mm_in_name(&ctx, i, name, sizeof(name));
-            printf("  [%u] %s%s\n", i, name, i == port_idx ? "  <-- will open" : "");
-        }
+        for (uint32_t i = 0; i < in_count; i++)
+            printf("  [%u] %s%s\n", i, mm_registry_in(&reg, i)->name,
+                   i == port_idx ? "  <-- will open" : "");
     }
 
     printf("\n=== MIDI Outputs ===\n");
-    uint32_t out_count = mm_out_count(&ctx);
+    uint32_t out_count = reg.out_count;
     if (out_count == 0) {
         printf("  (none)\n");
     } else {
-        for (uint32_t i = 0; i < out_count; i++) {
-            char name[256];
-            mm_out_name(&ctx, i, name, sizeof(name));
-            printf("  [%u] %s\n", i, name);
-        }
+        for (uint32_t i = 0; i < out_count; i++)
+            printf("  [%u] %s\n", i, mm_registry_out(&reg, i)->name);
     }
 
     if (in_count == 0) {
         printf("\nNo MIDI input devices found.\n");
+        mm_registry_uninit(&reg);
         mm_context_uninit(&ctx);
         return 0;
     }
@@ -148,15 +153,17 @@ int main(int argc, char* argv[]) {
     if (port_idx >= in_count) {
         fprintf(stderr, "\nPort index %u out of range (0..%u)\n",
                 port_idx, in_count - 1);
+        mm_registry_uninit(&reg);
         mm_context_uninit(&ctx);
         return 1;
     }
 
     printf("\nOpening input [%u]...\n", port_idx);
     mm_device dev;
-    r = mm_in_open(&ctx, &dev, port_idx, on_midi, NULL);
+    r = mm_in_open_port(&ctx, &dev, mm_registry_in(&reg, port_idx), on_midi, NULL);
+    mm_registry_uninit(&reg);
     if (r != MM_SUCCESS) {
-        fprintf(stderr, "mm_in_open: %s\n", mm_result_string(r));
+        fprintf(stderr, "mm_in_open_port: %s\n", mm_result_string(r));
         mm_context_uninit(&ctx);
         return 1;
     }
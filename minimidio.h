@@ -1,5 +1,271 @@
 /*
-minimidio.h - v0.4.1 - Single-file cross-platform MIDI input/output library
+minimidio.h - v0.5.0 - Single-file cross-platform MIDI input/output library
+
+CHANGES v0.5.0
+  Kernel-level routing between external ports:
+
+    mm_route_connect   (&ctx, in_idx, out_idx, &opts)  // in[in_idx] → out[out_idx]
+    mm_route_disconnect(&ctx, in_idx, out_idx)
+
+  Indices are the same ones mm_in_name / mm_out_name use. Events never pass
+  through this process; routes still alive at mm_context_uninit are torn down.
+
+    Linux:   snd_seq_subscribe_port between the two foreign ports. Optional
+             MM_ROUTE_EXCLUSIVE / MM_ROUTE_TIMESTAMP(_REAL) via mm_route_options.
+    macOS:   non-persistent MIDIThruConnection (routing in the MIDI server).
+             mm_route_options are ignored.
+    Windows: returns MM_NO_BACKEND.
+
+  Output groups — one device, many destinations:
+
+    mm_out_open_group  (&ctx, &dev)          // empty group
+    mm_out_group_add   (&dev, out_idx)       // members can change at runtime
+    mm_out_group_remove(&dev, out_idx)
+    mm_out_send        (&dev, &msg)          // reaches every member
+
+    Linux:   one ALSA source port subscribed to every member; the kernel does
+             the fan-out, so each send is one event and one drain.
+    macOS:   one output port, one packet list, MIDISend per member.
+    Windows: returns MM_NO_BACKEND.
+  mm_device gains an is_group field (int).
+
+  Port registry — enumerate once, index many times:
+
+    mm_port_registry reg;
+    mm_registry_init(&ctx, &reg);                 // one enumeration pass
+    mm_registry_in(&reg, i)->name                 // O(1), no kernel queries
+    mm_in_open_port(&ctx, &dev, mm_registry_in(&reg, i), cb, ud)
+    mm_registry_refresh(&reg);                    // explicit re-enumeration
+    mm_registry_uninit(&reg);
+
+  Each mm_port_info carries the name (same string mm_in_name returns), the
+  client:port address, MM_PORT_INPUT/OUTPUT flags and the raw ALSA capability
+  and type bits. Indices match mm_in_* / mm_out_* at the time of the snapshot.
+
+  Hotplug — keep a registry current without rescanning:
+
+    mm_registry_watch(&reg, on_port, ud)  // MM_PORT_ADDED / REMOVED / CHANGED
+    mm_registry_lock(&reg) ... mm_registry_unlock(&reg)  // read while watched
+
+    Linux:   subscribes a private handle to System:Announce (0:1) and applies
+             CLIENT_START/EXIT and PORT_START/EXIT/CHANGE to the registry
+             incrementally — no rescan of the client/port tree.
+    macOS / Windows: returns MM_NO_BACKEND.
+
+  Open by stable address or name pattern instead of enumeration index:
+
+    mm_in_open_by_address (&ctx, &dev, "20:0", cb, ud)          // client:port
+    mm_in_open_by_address (&ctx, &dev, "VMPK Output:0", cb, ud) // client name
+    mm_out_open_by_address(&ctx, &dev, "*FluidSynth*")          // name glob
+
+    Linux:   snd_seq_parse_address plus one targeted port query; a pattern
+             falls back to a single enumeration pass that stops at the first
+             match. Globs (* and ?) match the full mm_in_name/mm_out_name.
+    macOS / Windows: the spec is a glob over the port names.
+
+  No more port cap: ALSA enumeration no longer copies every port into a
+  fixed MM_MAX_PORTS-entry list on the stack (~17 KB per count/name/open
+  call). Index lookups walk the ports and stop at the one asked for; lists
+  live in a heap-backed mm_port_registry. MM_MAX_PORTS is no longer used.
+
+  Bulk open — dozens of ports, one enumeration, one receive thread:
+
+    uint32_t  idx[32] = { ... };
+    mm_device devs[32];
+    mm_result res[32];
+    mm_in_open_many (&ctx, devs, idx, 32, cb, ud, res)   // res[i] per port
+    mm_in_start_many(devs, 32)
+    mm_out_open_many(&ctx, outs, idx, n, res)
+    mm_in_open_many_ports / mm_out_open_many_ports       // registry entries
+
+    Linux:   indices resolved in one walk of the port tree. All inputs on a
+             context now share one receive thread (started by the first
+             mm_in_start, joined by mm_context_uninit) that dispatches by
+             destination port; devices no longer own a thread or a pipe.
+    macOS / Windows: loops over the single-device calls.
+
+  Multi-port virtual input — N named ports, one device, one thread:
+
+    const char* parts[32] = { "engine-part-1", ..., "engine-part-32" };
+    mm_in_open_virtual_multi(&ctx, &dev, parts, 32, cb, ud)  // names may be NULL
+    msg->port_index                                       // 0 … 31
+
+  mm_message gains port_index (uint16_t, 0 for single-port devices); it
+  fits in existing padding, so sizeof(mm_message) is unchanged.
+    Linux:   N ALSA ports, all mapped to the device in the context's
+             dispatcher; sysex is reassembled per port.
+    macOS:   N MIDIDestinationCreate endpoints.
+    Windows: returns MM_NO_BACKEND.
+
+  Sender tagging — tell apart the apps feeding one virtual input:
+
+    msg->source_client, msg->source_port             // ALSA sender address
+    mm_registry_find(&reg, msg->source_client, msg->source_port)->name
+
+  mm_message gains source_client / source_port (int16_t, still in existing
+  padding; -1 on CoreMIDI/WinMM). mm_registry_find looks an address up in
+  O(log n). ALSA sysex reassembly tracks its sender, so interleaved chunks
+  from two apps are never spliced into one message.
+
+  Smaller devices — SysEx storage is no longer embedded in mm_device:
+
+    ALSA:    input reassembly buffer allocated at mm_in_start (per port
+             for multi-port devices); outputs send in place.
+    macOS:   the MIDISendSysex request + buffer allocated on first use.
+    Windows: inputs allocate the queued sysex buffer at open; outputs
+             send in place.
+  sizeof(mm_device) drops from ~4.2 KB to under two cache lines on LP64,
+  with the receive-path fields first. MM_SYSEX_BUF_SIZE still caps the
+  message size.
+
+  Allocation callbacks — route every library allocation through your own
+  allocator (miniaudio's ma_allocation_callbacks pattern):
+
+    mm_context_config cfg = mm_context_config_init();
+    cfg.name = "my-app";
+    cfg.allocation_callbacks = (mm_allocation_callbacks){ ud, my_malloc,
+                                                          my_realloc, my_free };
+    mm_context_init_ex(&ctx, &cfg);      // mm_context_init wraps this
+
+  Set all three callbacks or none. Covers devices, sysex buffers, groups,
+  registries and the poll threads' pollfd sets, which are now built before
+  the threads start. Library threads don't allocate: inputs' SysEx
+  buffers and UMP decoders are made at mm_in_start (CoreMIDI virtual
+  inputs: at open), and the registry watch thread works in room reserved
+  by mm_registry_refresh (MM_REGISTRY_RESERVE ports). cfg.lazy_sysex = 1
+  trades that for memory: the receive thread makes an input's SysEx
+  buffer when its first SysEx arrives.
+  alsa-lib's and CoreMIDI's own allocations are out of reach. mm_context
+  gains an alloc field.
+
+  Runtime configuration — the limits that were compile-time-only now live
+  in mm_context_config; the MM_* macros become the defaults:
+
+    cfg.sysex_size      = 64*1024;            // per-port sysex cap
+    cfg.max_routes      = 512;                // mm_route_connect limit
+    cfg.thread_priority = 70;                 // SCHED_FIFO receive thread
+    cfg.alsa.input_pool = 1000;               // snd_seq client pool / buffers
+    cfg.delivery        = MM_DELIVERY_POLL;   // no thread: you dispatch
+    ...
+    mm_context_dispatch(&ctx, 10, &n);        // run pending callbacks here
+
+  Sysex buffers are sized from the context; route tables grow on demand.
+  thread_priority falls back to default scheduling when SCHED_FIFO is
+  refused. MM_DELIVERY_POLL is ALSA-only (CoreMIDI and WinMM own their
+  receive threads) and returns MM_NO_BACKEND elsewhere. mm_context gains
+  the resolved config.
+
+  Byte-stream parser — one portable, incremental MIDI 1.0 decoder:
+
+    mm_parser p; mm_parser_init(&p, buf, sizeof(buf));   // buf: SysEx only
+    mm_parser_feed(&p, bytes, n, on_message, ud);        // any chunking
+
+  Running status, real-time bytes anywhere (also inside SysEx), SysEx
+  across feeds, undefined status bytes skipped; no allocation. CoreMIDI
+  input now goes through it: running status from hardware is decoded
+  instead of skipped, SysEx split over packets is reassembled, and the
+  timestamp is converted once per packet rather than per byte.
+
+  Status tables — one 256-entry constant table (status byte → type, data
+  length, flags) and its inverse (type → status, length), built at compile
+  time. The parser, WinMM input and all three mm_out_send paths decode and
+  encode through them instead of per-backend switch chains. ALSA input
+  keeps its event-type switch: the sequencer delivers events, not bytes.
+    - ALSA mm_out_send now sends MM_POLY_PRESSURE and MM_CHANNEL_PRESSURE
+      (previously MM_INVALID_ARG).
+    - mm_make_message understands system statuses (0xF8 → MM_CLOCK, …).
+
+  Vector scanning — mm_scan_status(bytes, n) finds the next byte >= 0x80
+  32 (AVX2) or 16 (SSE2) bytes per step, picked at run time, with an
+  8-byte SWAR fallback elsewhere or under MM_NO_SIMD. The parser skips
+  SysEx data runs with it, copying each run in one memcpy. On an 8 MB
+  SysEx in 256-byte packets: ~250 MB/s → ~7.5 GB/s (examples/bench.c).
+
+  Packed messages — 8 bytes instead of 40, eight to a cache line:
+
+    mm_packed_message p;                    // word: status|d1|d2|port
+    mm_pack(msg, base_time, &p);            // time: µs since base_time
+    mm_message m = mm_unpack(&p, base_time);
+
+  Lossless for short messages (timestamps to 1 µs, port_index to 255);
+  SysEx has no packed form. mm_pack_messages / mm_unpack_messages convert
+  arrays, and mm_packed_ring is a lock-free SPSC ring over caller storage
+  for moving events out of a callback: mm_packed_ring_push_message in the
+  callback, mm_packed_ring_pop on the consumer thread.
+
+  Event batches — columnar (structure-of-arrays) storage for analysis:
+
+    mm_event_batch b; mm_event_batch_init(&b, NULL, 0);
+    mm_event_batch_append(&b, msgs, n);             // or _append_packed
+    for (size_t i = 0; i < b.count; i++)            // touches status only
+        hist[b.status[i] >> 4]++;
+
+  timestamp / status / data1 / data2 / port_index are separate arrays;
+  SysEx bytes go to one payload blob, addressed by sysex_offset/size.
+  mm_event_batch_get rebuilds a row as an mm_message. Storage comes from
+  optional mm_allocation_callbacks.
+
+  Batch kernels — filter (mm_filter: a bit per status byte, built from a
+  type mask and a channel mask), channel remap, clamped transpose and a
+  128-entry velocity curve, each over a whole mm_event_batch or packed
+  array. On batches x86 runs them 32 (AVX2) or 16 (SSE2) events per step;
+  examples/bench.c compares them with the same work per mm_message.
+
+  Universal MIDI Packets — MIDI 2.0's wire format, in software only:
+
+    uint32_t ump[64]; size_t words;
+    mm_ump_from_messages(msgs, n, MM_UMP_PROTOCOL_MIDI2, ump, 64, &words);
+    mm_ump_decode(&dec, ump, words, on_message, ud);   // and back
+
+  Channel voice as MT 0x2 (MIDI 1.0) or MT 0x4 (MIDI 2.0, values up-scaled
+  by the spec's min-centre-max rule, mm_ump_scale_up), system MT 0x1,
+  SysEx as MT 0x3 packets. mm_ump_encoder converts a raw byte stream
+  incrementally and packetizes SysEx on the fly. No allocation anywhere;
+  group ↔ port_index.
+
+  UMP I/O — config.ump = MM_UMP_PROTOCOL_MIDI2 (or _MIDI1) opens the ALSA
+  client as a UMP client (alsa-lib 1.2.10+, kernel 6.5+), so MIDI 2.0
+  endpoints reach us without the kernel's down-conversion.
+  mm_in_set_ump_callback delivers packets, mm_out_send_ump sends them, on
+  normal and virtual ports alike. mm_context_is_ump reports the outcome;
+  an older kernel or alsa-lib keeps a MIDI 1.0 client and both calls
+  translate in software instead, as they do on CoreMIDI and WinMM.
+
+  Fuzzing — examples/fuzz.c builds as a libFuzzer target, an AFL @@ target
+  or a standalone runner (-random N) and checks the parser, short-message,
+  UMP and ALSA decoders against each other. examples/bench.c times the
+  parser and UMP paths on four synthetic streams.
+
+  Clock tracking — mm_clock_tracker replaces BPM from one clock interval:
+
+    mm_clock_tracker_push(&clk, msg);                       // input callback
+    mm_clock_tracker_read(&clk, mm_in_time(&dev), &info);   // any thread
+
+  A delay-locked loop with its bandwidth in Hz gives tempo, song position
+  (START / CONTINUE / SPP), phase, the predicted next clock, a confidence
+  figure and dropout detection; short gaps count as lost clocks. Reads
+  are seqlock copies, no allocation. mm_in_time returns the current time
+  on an input's timestamp clock on all three backends.
+
+  Clock master — mm_clock_master sends MIDI clock from an ALSA sequencer
+  queue. Clocks are queued by tick a window ahead (refill every 50 ms)
+  and the kernel timer sends them. start / continue / stop / locate send
+  the transport messages, and set_tempo retimes the queue on the next
+  tick. CoreMIDI and WinMM return MM_NO_BACKEND.
+
+  MTC generation — mm_mtc_generator returns quarter-frame messages with
+  their timestamps for any of the four rates. Each one is computed from
+  the locate time, so scheduling them ahead or sending them late doesn't
+  move the phase. Locate also returns the full-frame SysEx.
+  mm_out_send_at sends a message at a given mm_in_time: on the context's
+  ALSA queue, or as the CoreMIDI packet time. WinMM: MM_NO_BACKEND.
+  mm_mtc_to_frames / mm_mtc_from_frames count frames, drop-frame included.
+
+  MTC chase — mm_mtc_chaser replaces mm_mtc_push for following timecode.
+  It checks piece order and follows forward and reverse play. It takes
+  full-frame SysEx locates and adds the 2-frame offset. It flags a
+  dropout. The position is a fractional frame count anchored to the
+  quarter-frame timestamps. Any thread can read it, as a seqlock copy.
 
 CHANGES v0.4.1
   Bug fixes — no API changes.
@@ -179,9 +445,11 @@ SONG POSITION MATHS
 
 CONFIGURATION DEFINES (before #include)
 
-    #define MM_MAX_PORTS          64   // max enumerable ports
-    #define MM_SYSEX_BUF_SIZE  4096   // per-device sysex buffer (bytes)
+    #define MM_MAX_ROUTES         64   // default mm_context_config.max_routes
+    #define MM_SYSEX_BUF_SIZE  4096   // default mm_context_config.sysex_size
+    #define MM_REGISTRY_RESERVE  64   // hotplug headroom per registry refresh
     #define MM_ASSERT(x)              // override assertion macro
+    #define MM_NO_SIMD                // scalar mm_scan_status (no SSE2/AVX2)
 */
 
 #ifndef MINIMIDIO_H
@@ -197,12 +465,15 @@ extern "C" {
 
 /* ── Configuration ─────────────────────────────────────────────────────────── */
 
-#ifndef MM_MAX_PORTS
-#  define MM_MAX_PORTS 64
-#endif
 #ifndef MM_SYSEX_BUF_SIZE
 #  define MM_SYSEX_BUF_SIZE 4096
 #endif
+#ifndef MM_MAX_ROUTES
+#  define MM_MAX_ROUTES 64
+#endif
+#ifndef MM_REGISTRY_RESERVE
+#  define MM_REGISTRY_RESERVE 64
+#endif
 #ifndef MM_ASSERT
 #  include <assert.h>
 #  define MM_ASSERT(x) assert(x)
@@ -286,6 +557,16 @@ typedef struct mm_message {
        Quarter notes = song_position / 4.0                                   */
     uint16_t song_position;
 
+    /* Which port of a multi-port virtual device the message arrived on
+       (0 … count-1); always 0 for single-port devices.                     */
+    uint16_t port_index;
+
+    /* Sender's ALSA client:port, so one virtual input can tell its upstream
+       apps apart (see mm_registry_find). -1/-1 where the backend cannot
+       know: CoreMIDI, WinMM, and messages built with mm_make_message.      */
+    int16_t  source_client;
+    int16_t  source_port;
+
     /* MM_SYSEX only */
     const uint8_t* sysex;
     size_t         sysex_size;
@@ -296,9 +577,56 @@ typedef struct mm_message {
 typedef struct mm_context mm_context;
 typedef struct mm_device  mm_device;
 
-/* Called from a background thread. Do NOT call mm_in_stop/close from within. */
+/* Called from a background thread (MM_DELIVERY_POLL: from mm_context_dispatch).
+   Do NOT call mm_in_stop / mm_in_close / mm_context_uninit from within: ALSA
+   returns MM_INVALID_ARG, the other backends can deadlock. On ALSA every
+   input of a context is dispatched by one thread under one lock, so a slow
+   callback holds up all of them — hand heavy work to another thread.      */
 typedef void (*mm_callback)(mm_device* dev, const mm_message* msg, void* userdata);
 
+/* ── Allocation callbacks ───────────────────────────────────────────────────
+   Every heap allocation the library makes goes through these (miniaudio's
+   ma_allocation_callbacks pattern). Set all three or none; none means
+   malloc / realloc / free. Allocations made inside alsa-lib or CoreMIDI
+   themselves are outside our reach.                                        */
+typedef struct mm_allocation_callbacks {
+    void* user_data;
+    void* (*on_malloc) (size_t size, void* user_data);
+    void* (*on_realloc)(void* p, size_t size, void* user_data);
+    void  (*on_free)   (void* p, void* user_data);
+} mm_allocation_callbacks;
+
+/* Who calls mm_callback. THREAD: a library-owned receive thread (the
+   default). POLL: nothing runs in the background; callbacks fire from
+   mm_context_dispatch on your thread. POLL is ALSA-only.                   */
+typedef enum mm_delivery_mode {
+    MM_DELIVERY_THREAD = 0,
+    MM_DELIVERY_POLL   = 1
+} mm_delivery_mode;
+
+/* Context configuration for mm_context_init_ex. Start from
+   mm_context_config_init() so new fields keep their defaults; a zero size
+   or limit also means "default". The MM_* config macros are the defaults. */
+typedef struct mm_context_config {
+    const char*             name;                  /* NULL = "minimidio"   */
+    mm_allocation_callbacks allocation_callbacks;  /* zeroed = C runtime   */
+    size_t                  sysex_size;    /* max sysex; MM_SYSEX_BUF_SIZE */
+    uint32_t                max_routes;    /* mm_route_connect; MM_MAX_ROUTES */
+    mm_delivery_mode        delivery;
+    int                     thread_priority; /* >0: SCHED_FIFO receive thread
+                                                (ALSA); 0 = inherit        */
+    int                     ump;   /* MM_UMP_PROTOCOL_MIDI1/2: UMP client (ALSA);
+                                      0 = MIDI 1.0 client                  */
+    int                     lazy_sysex; /* 1: an input's SysEx buffer is made
+                                      by the receive thread on its first
+                                      SysEx; 0 = at start / open, so the
+                                      receive thread never allocates       */
+    struct {                               /* 0 = alsa-lib default (bytes / events) */
+        size_t input_buffer, output_buffer;
+        size_t input_pool,   output_pool;
+    } alsa;
+} mm_context_config;
+
 /* ══════════════════════════════════════════════════════════════════════════════
    MTC utilities — header-only, always available
    ══════════════════════════════════════════════════════════════════════════ */
@@ -348,18 +676,647 @@ static inline double mm_mtc_to_seconds(const mm_mtc_frame* f)
          + (double)f->frames  / fps;
 }
 
-/* Helper: pack raw status + 2 data bytes into an mm_message */
-static inline mm_message mm_make_message(uint8_t status, uint8_t d1, uint8_t d2)
+/* Frames per second, exactly: 29.97 drop-frame is 30000 / 1001. */
+static inline double mm_mtc_frame_rate(mm_mtc_rate r)
+{
+    static const double rates[] = { 24.0, 25.0, 30000.0 / 1001.0, 30.0 };
+    return rates[r & 3];
+}
+
+/* Frames per day at rate r; frame counts wrap here. */
+static inline uint32_t mm_mtc_frames_per_day(mm_mtc_rate r)
+{
+    static const uint32_t n[] = { 24u * 86400u, 25u * 86400u, 144u * 17982u, 30u * 86400u };
+    return n[r & 3];
+}
+
+/* Timecode → frames since 00:00:00:00. Drop-frame skips labels ;00 and ;01
+   each minute except every tenth; a skipped label counts as the next one. */
+static inline uint32_t mm_mtc_to_frames(const mm_mtc_frame* f)
+{
+    static const uint32_t fps[] = { 24, 25, 30, 30 };
+    const uint32_t mins = (uint32_t)f->hours * 60u + f->minutes;
+    uint32_t n = (mins * 60u + f->seconds) * fps[f->rate & 3] + f->frames;
+    if ((f->rate & 3) == MM_MTC_30FPS_DROP) {
+        n -= 2u * (mins - mins / 10u);
+        if (f->seconds == 0 && f->frames < 2 && mins % 10u) n += 2u - f->frames;
+    }
+    return n % mm_mtc_frames_per_day(f->rate);
+}
+
+/* Frames since 00:00:00:00 → timecode at rate r (wrapping at 24 h). */
+static inline void mm_mtc_from_frames(uint32_t n, mm_mtc_rate r, mm_mtc_frame* out)
+{
+    static const uint32_t fps[] = { 24, 25, 30, 30 };
+    n %= mm_mtc_frames_per_day(r);
+    if ((r & 3) == MM_MTC_30FPS_DROP) {
+        const uint32_t tens = n / 17982u, rem = n % 17982u;
+        n += 18u * tens + (rem > 1 ? 2u * ((rem - 2u) / 1798u) : 0u);
+    }
+    const uint32_t f = fps[r & 3];
+    out->frames  = (uint8_t)(n % f);
+    out->seconds = (uint8_t)(n / f % 60u);
+    out->minutes = (uint8_t)(n / (f * 60u) % 60u);
+    out->hours   = (uint8_t)(n / (f * 3600u));
+    out->rate    = r;
+}
+
+/* Full-frame SysEx, F0 7F 7F 01 01 hr mn sc fr F7 (rate in hr bits 5-6):
+   sent on locate so a chaser jumps straight there.                        */
+#define MM_MTC_FULL_FRAME_SIZE 10
+
+static inline void mm_mtc_full_frame(const mm_mtc_frame* f, uint8_t out[MM_MTC_FULL_FRAME_SIZE])
+{
+    out[0] = 0xF0; out[1] = 0x7F; out[2] = 0x7F; out[3] = 0x01; out[4] = 0x01;
+    out[5] = (uint8_t)(((f->rate & 3) << 5) | (f->hours & 0x1F));
+    out[6] = (uint8_t)(f->minutes & 0x3F);
+    out[7] = (uint8_t)(f->seconds & 0x3F);
+    out[8] = (uint8_t)(f->frames  & 0x1F);
+    out[9] = 0xF7;
+}
+
+/* ── Status tables (private) ───────────────────────────────────────────────
+   One entry per byte value: message type, data bytes that follow, and
+   flags. Data bytes (0x00–0x7F) and undefined statuses are all-zero. Every
+   decode path reads these instead of re-deriving the same facts in a
+   switch; mm__type_table is the inverse, indexed by mm_message_type.       */
+typedef struct mm__status_info {
+    uint8_t type;    /* mm_message_type, 0 = not a message status */
+    uint8_t len;     /* data bytes after the status */
+    uint8_t flags;   /* MM__ST_* */
+} mm__status_info;
+
+#define MM__ST_CHANNEL   0x01   /* low nibble is the channel  */
+#define MM__ST_COMMON    0x02   /* F1–F6: clears running status */
+#define MM__ST_REALTIME  0x04   /* F8–FF: may appear anywhere  */
+#define MM__ST_SYSEX     0x08   /* F0 */
+
+#define MM__ST_X4(t,n,f)    {t,n,f}, {t,n,f}, {t,n,f}, {t,n,f}
+#define MM__ST_X16(t,n,f)   MM__ST_X4(t,n,f), MM__ST_X4(t,n,f), \
+                            MM__ST_X4(t,n,f), MM__ST_X4(t,n,f)
+#define MM__ST_X128(t,n,f)  MM__ST_X16(t,n,f), MM__ST_X16(t,n,f), MM__ST_X16(t,n,f), \
+                            MM__ST_X16(t,n,f), MM__ST_X16(t,n,f), MM__ST_X16(t,n,f), \
+                            MM__ST_X16(t,n,f), MM__ST_X16(t,n,f)
+#define MM__ST_CH(t,n)      MM__ST_X16(t, n, MM__ST_CHANNEL)
+
+static const mm__status_info mm__status_table[256] = {
+    MM__ST_X128(0, 0, 0),
+    MM__ST_CH(MM_NOTE_OFF, 2),        MM__ST_CH(MM_NOTE_ON, 2),
+    MM__ST_CH(MM_POLY_PRESSURE, 2),   MM__ST_CH(MM_CONTROL_CHANGE, 2),
+    MM__ST_CH(MM_PROGRAM_CHANGE, 1),  MM__ST_CH(MM_CHANNEL_PRESSURE, 1),
+    MM__ST_CH(MM_PITCH_BEND, 2),
+    { MM_SYSEX,             0, MM__ST_SYSEX    },   /* F0 */
+    { MM_MTC_QUARTER_FRAME, 1, MM__ST_COMMON   },   /* F1 */
+    { MM_SONG_POSITION,     2, MM__ST_COMMON   },   /* F2 */
+    { MM_SONG_SELECT,       1, MM__ST_COMMON   },   /* F3 */
+    { 0,                    0, MM__ST_COMMON   },   /* F4 undefined */
+    { 0,                    0, MM__ST_COMMON   },   /* F5 undefined */
+    { MM_TUNE_REQUEST,      0, MM__ST_COMMON   },   /* F6 */
+    { 0,                    0, MM__ST_COMMON   },   /* F7 EOX */
+    { MM_CLOCK,             0, MM__ST_REALTIME },   /* F8 */
+    { 0,                    0, MM__ST_REALTIME },   /* F9 undefined */
+    { MM_START,             0, MM__ST_REALTIME },   /* FA */
+    { MM_CONTINUE,          0, MM__ST_REALTIME },   /* FB */
+    { MM_STOP,              0, MM__ST_REALTIME },   /* FC */
+    { 0,                    0, MM__ST_REALTIME },   /* FD undefined */
+    { MM_ACTIVE_SENSE,      0, MM__ST_REALTIME },   /* FE */
+    { MM_RESET,             0, MM__ST_REALTIME },   /* FF */
+};
+
+/* mm_message_type → status byte (channel 0) and data length; status 0 =
+   not encodable as a short message (MM_SYSEX, gaps).                      */
+typedef struct mm__type_info { uint8_t status, len; } mm__type_info;
+
+static const mm__type_info mm__type_table[32] = {
+    {0,0},    {0,0},    {0,0},    {0,0},    {0,0},    {0,0},    {0,0},    {0,0},
+    {0x80,2}, {0x90,2}, {0xA0,2}, {0xB0,2}, {0xC0,1}, {0xD0,1}, {0xE0,2}, {0,0},
+    {0,0},    {0xF1,1}, {0xF2,2}, {0xF3,1}, {0xF6,0}, {0,0},    {0,0},    {0,0},
+    {0xF8,0}, {0,0},    {0xFA,0}, {0xFB,0}, {0xFC,0}, {0,0},    {0xFE,0}, {0xFF,0},
+};
+
+/* Decode one short message. Branch-free apart from the table load: fields
+   a status doesn't use are masked to zero. type is 0 for non-messages.    */
+static inline mm_message mm__decode(uint8_t status, uint8_t d1, uint8_t d2)
 {
+    const mm__status_info si = mm__status_table[status];
     mm_message m;
     memset(&m, 0, sizeof(m));
-    m.type    = (mm_message_type)((status >> 4) & 0x0F);
-    m.channel = status & 0x0F;
+    m.type    = (mm_message_type)si.type;
+    m.channel = (uint8_t)(status & (0x0F & -(si.flags & MM__ST_CHANNEL)));
+    m.data[0] = (uint8_t)(d1 & -(si.len > 0));
+    m.data[1] = (uint8_t)(d2 & -(si.len > 1));
+    m.song_position = (uint16_t)((m.data[0] | ((uint16_t)m.data[1] << 7))
+                                 & -(status == 0xF2));
+    m.source_client = m.source_port = -1;
+    return m;
+}
+
+/* Encode msg as status + data bytes into out[3]. Returns the total length,
+   or 0 if msg->type has no short-message form.                            */
+static inline int mm__encode(const mm_message* msg, uint8_t out[3])
+{
+    if ((unsigned)msg->type >= 32) return 0;
+    const mm__type_info ti = mm__type_table[msg->type];
+    if (!ti.status) return 0;
+    const uint16_t sp = msg->song_position;
+    out[0] = (uint8_t)(ti.status | (ti.status < 0xF0 ? (msg->channel & 0x0F) : 0));
+    out[1] = (ti.status == 0xF2) ? (uint8_t)(sp & 0x7F)        : msg->data[0];
+    out[2] = (ti.status == 0xF2) ? (uint8_t)((sp >> 7) & 0x7F) : msg->data[1];
+    if (ti.len < 2) out[2] = 0;
+    if (ti.len < 1) out[1] = 0;
+    return 1 + ti.len;
+}
+
+/* Helper: pack raw status + 2 data bytes into an mm_message. Any status
+   works, system messages included; data bytes are kept as given.          */
+static inline mm_message mm_make_message(uint8_t status, uint8_t d1, uint8_t d2)
+{
+    mm_message m = mm__decode(status, d1, d2);
     m.data[0] = d1;
     m.data[1] = d2;
     return m;
 }
 
+/* ══════════════════════════════════════════════════════════════════════════════
+   Byte-stream parser — portable, allocation-free
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* Turns raw MIDI 1.0 bytes from any byte-oriented transport into
+   mm_messages, incrementally: a message may be split across any number of
+   feeds. Handles running status, real-time bytes anywhere (including inside
+   SysEx), and skips undefined status bytes (F4 F5 F9 FD) and orphan data.
+
+   SysEx: a complete F0…F7 inside one feed is emitted in place, pointing
+   into the caller's bytes. One spanning feeds (or broken up by real-time
+   bytes) is assembled in the caller-supplied buffer; with no buffer, or when
+   it outgrows it, that message is dropped. A SysEx cut short by another
+   status byte is dropped too.                                              */
+typedef void (*mm_parser_emit)(const mm_message* msg, void* userdata);
+
+typedef struct mm_parser {
+    double   timestamp;      /* stamped on every emitted message; set freely */
+    uint8_t* sysex;          /* assembly buffer (may be NULL)                */
+    size_t   sysex_cap;
+    size_t   sysex_len;
+    uint16_t port_index;     /* stamped on every emitted message            */
+    uint8_t  running;        /* running status 0x80–0xEF, 0 = none          */
+    uint8_t  status;         /* status of the message being collected       */
+    uint8_t  data[2];
+    uint8_t  have, need;
+    uint8_t  in_sysex;       /* 1 = inside F0…F7, 2 = overflowed: dropping  */
+} mm_parser;
+
+/* A zeroed mm_parser is a valid parser with no SysEx buffer. */
+void mm_parser_init (mm_parser* p, uint8_t* sysex_buf, size_t sysex_cap);
+void mm_parser_reset(mm_parser* p);   /* drop partial state, keep the buffer */
+void mm_parser_feed (mm_parser* p, const uint8_t* bytes, size_t n,
+                     mm_parser_emit emit, void* userdata);
+
+/* Offset of the first byte >= 0x80 in bytes[0..n), or n if there is none:
+   the next status byte, and inside SysEx the F7 (or whatever cuts it
+   short). 16 or 32 bytes per step on x86 (SSE2 / AVX2, chosen at run
+   time), 8 elsewhere. mm_scan_backend names the kernel in use.            */
+size_t      mm_scan_status (const uint8_t* bytes, size_t n);
+const char* mm_scan_backend(void);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+   Packed messages — 8 bytes per short message, for queues and captures
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* word: status | data1 << 8 | data2 << 16 | port_index << 24 (wire bytes,
+   so song position travels as its two 7-bit halves). time: microseconds
+   since a base time the owner picks. It saturates: from ~71.6 minutes
+   after base_time on it packs as 0xFFFFFFFF (before base_time, as 0), so
+   longer sessions must re-base — pick a newer base_time, for a ring set
+   ring->base_time while it is empty. Every short-message field
+   round-trips exactly, apart from port_index above 255 and the ALSA
+   sender address. Within range the timestamp round-trips to the
+   microsecond. SysEx has no packed form.                                  */
+typedef struct mm_packed_message {
+    uint32_t word;
+    uint32_t time;
+} mm_packed_message;
+
+/* Returns 1 and fills *out, or 0 for SysEx and invalid types. */
+static inline int mm_pack(const mm_message* msg, double base_time, mm_packed_message* out)
+{
+    uint8_t raw[3];
+    if (!mm__encode(msg, raw)) return 0;
+    double us = (msg->timestamp - base_time) * 1e6 + 0.5;
+    out->word = (uint32_t)raw[0] | ((uint32_t)raw[1] << 8) | ((uint32_t)raw[2] << 16)
+              | ((uint32_t)(msg->port_index & 0xFF) << 24);
+    out->time = (us <= 0.0) ? 0u : (us >= 4294967295.0) ? 0xFFFFFFFFu : (uint32_t)us;
+    return 1;
+}
+
+static inline mm_message mm_unpack(const mm_packed_message* p, double base_time)
+{
+    mm_message m = mm__decode((uint8_t)p->word, (uint8_t)(p->word >> 8),
+                              (uint8_t)(p->word >> 16));
+    m.port_index = (uint16_t)(p->word >> 24);
+    m.timestamp  = base_time + (double)p->time * 1e-6;
+    return m;
+}
+
+/* Bulk forms. mm_pack_messages skips what has no packed form and returns
+   how many it wrote; out needs room for n.                                */
+size_t mm_pack_messages  (const mm_message* in, size_t n, double base_time,
+                          mm_packed_message* out);
+void   mm_unpack_messages(const mm_packed_message* in, size_t n, double base_time,
+                          mm_message* out);
+
+/* Lock-free single-producer / single-consumer ring of packed messages, in
+   caller-owned storage (capacity a power of two). Made for handing events
+   from an mm_callback to another thread: push never blocks or allocates.
+   head and tail sit on separate cache lines.                               */
+typedef struct mm_packed_ring {
+    mm_packed_message* buf;
+    uint32_t           mask;
+    double             base_time;        /* for the _message helpers        */
+    uint32_t           head;             /* producer-owned: next write      */
+    uint8_t            pad0_[60];
+    uint32_t           tail;             /* consumer-owned: next read       */
+    uint8_t            pad1_[60];
+} mm_packed_ring;
+
+mm_result mm_packed_ring_init (mm_packed_ring* r, mm_packed_message* storage,
+                               uint32_t capacity, double base_time);
+uint32_t  mm_packed_ring_push (mm_packed_ring* r, const mm_packed_message* msgs, uint32_t count);
+uint32_t  mm_packed_ring_pop  (mm_packed_ring* r, mm_packed_message* out, uint32_t max);
+uint32_t  mm_packed_ring_count(const mm_packed_ring* r);
+
+/* Producer-side helper for use inside an mm_callback: packs and pushes one
+   message. Returns 0 when it has no packed form or the ring is full.      */
+int       mm_packed_ring_push_message(mm_packed_ring* r, const mm_message* msg);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+   Event batches — columnar storage for offline analysis
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* One contiguous array per field, so a loop over status bytes touches only
+   status bytes and auto-vectorizes. Event i is (timestamp[i], status[i],
+   data1[i], data2[i], port_index[i]); status is the wire status byte
+   (channel included, 0xF0 for SysEx, whose bytes sit at
+   payload[sysex_offset[i]] for sysex_size[i] bytes). sysex_offset and
+   sysex_size are 0 for other events. Arrays grow through the allocation
+   callbacks given at init.                                                */
+typedef struct mm_event_batch {
+    double*   timestamp;
+    uint8_t*  status;
+    uint8_t*  data1;
+    uint8_t*  data2;
+    uint16_t* port_index;
+    uint32_t* sysex_offset;
+    uint32_t* sysex_size;
+    uint8_t*  payload;
+    size_t    count, capacity;
+    size_t    payload_size, payload_capacity;
+    mm_allocation_callbacks alloc;
+} mm_event_batch;
+
+/* callbacks may be NULL (malloc / realloc / free). */
+mm_result  mm_event_batch_init  (mm_event_batch* b, const mm_allocation_callbacks* callbacks,
+                                 size_t capacity);
+void       mm_event_batch_uninit(mm_event_batch* b);
+void       mm_event_batch_clear (mm_event_batch* b);   /* keeps the memory */
+mm_result  mm_event_batch_reserve(mm_event_batch* b, size_t capacity);
+
+/* Append n events; SysEx bytes are copied into the payload blob. */
+mm_result  mm_event_batch_append       (mm_event_batch* b, const mm_message* msgs, size_t n);
+mm_result  mm_event_batch_append_packed(mm_event_batch* b, const mm_packed_message* msgs,
+                                        size_t n, double base_time);
+
+/* Row view of event i; a SysEx points into the payload (valid until the
+   next append).                                                          */
+mm_message mm_event_batch_get(const mm_event_batch* b, size_t i);
+
+/* ── Batch kernels ─────────────────────────────────────────────────────────
+   The common pipeline operations, one pass over a whole array instead of a
+   branchy step per message. Two forms each: on an mm_event_batch, where
+   x86 runs them 32 (AVX2, chosen at run time) or 16 (SSE2) events per
+   step, and on mm_packed_message arrays in plain C.
+
+   filter     keep events whose status passes an mm_filter; compacts in
+              place and returns the new count
+   remap      channel c → map[c] (map entries & 0x0F), channel messages only
+   transpose  note on / off / poly pressure note numbers, clamped to 0–127
+   velocity   note-on velocity v → lut[v]; velocity 0 (a note-off) stays 0 */
+
+/* One bit per status byte. Build it with mm_filter_init; set or clear
+   single statuses by hand for anything finer.                             */
+typedef struct mm_filter { uint8_t bits[32]; } mm_filter;
+
+#define MM_TYPE_BIT(t) (1u << (t))   /* for mm_filter_init's type_mask */
+
+/* Pass the types in type_mask (MM_TYPE_BIT(MM_NOTE_ON) | ...) and, for
+   channel messages, only the channels in channel_mask (bit c = channel c). */
+void   mm_filter_init(mm_filter* f, uint32_t type_mask, uint16_t channel_mask);
+
+size_t mm_event_batch_filter   (mm_event_batch* b, const mm_filter* f);
+void   mm_event_batch_remap    (mm_event_batch* b, const uint8_t map[16]);
+void   mm_event_batch_transpose(mm_event_batch* b, int semitones);
+void   mm_event_batch_velocity (mm_event_batch* b, const uint8_t lut[128]);
+
+size_t mm_packed_filter   (mm_packed_message* msgs, size_t n, const mm_filter* f);
+void   mm_packed_remap    (mm_packed_message* msgs, size_t n, const uint8_t map[16]);
+void   mm_packed_transpose(mm_packed_message* msgs, size_t n, int semitones);
+void   mm_packed_velocity (mm_packed_message* msgs, size_t n, const uint8_t lut[128]);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+   Universal MIDI Packets — MIDI 2.0 wire format, pure software
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* A UMP is 1, 2, 3 or 4 32-bit words; the top nibble of the first word is
+   the message type, which alone fixes the size, and the next nibble is the
+   group (0–15, sixteen "cables" per stream). Streams here are plain
+   uint32_t arrays in host order, packets back to back.
+
+   Translation maps group ↔ port_index: mm_ump_from_message sends a message
+   on group port_index & 15, and decoded messages carry their group as
+   port_index.                                                              */
+typedef enum mm_ump_type {
+    MM_UMP_UTILITY     = 0x0,   /*  32-bit  NOOP, jitter-reduction stamps     */
+    MM_UMP_SYSTEM      = 0x1,   /*  32-bit  system common / real-time         */
+    MM_UMP_MIDI1_VOICE = 0x2,   /*  32-bit  MIDI 1.0 channel voice            */
+    MM_UMP_SYSEX7      = 0x3,   /*  64-bit  SysEx, 6 bytes per packet         */
+    MM_UMP_MIDI2_VOICE = 0x4,   /*  64-bit  MIDI 2.0 channel voice            */
+    MM_UMP_DATA128     = 0x5,   /* 128-bit  SysEx8, mixed data sets           */
+    MM_UMP_FLEX_DATA   = 0xD,   /* 128-bit  tempo, meter, text, …             */
+} mm_ump_type;
+
+/* Which channel voice form to produce: MT 0x2 keeps MIDI 1.0 values as
+   they are, MT 0x4 up-scales them to 16/32 bits.                          */
+typedef enum mm_ump_protocol {
+    MM_UMP_PROTOCOL_MIDI1 = 1,
+    MM_UMP_PROTOCOL_MIDI2 = 2,
+} mm_ump_protocol;
+
+/* SysEx7 packet status (bits 20–23 of word 0). */
+#define MM_UMP_SYSEX_COMPLETE 0x0
+#define MM_UMP_SYSEX_START    0x1
+#define MM_UMP_SYSEX_CONTINUE 0x2
+#define MM_UMP_SYSEX_END      0x3
+
+#define MM_UMP_TYPE(w0)  ((uint32_t)(w0) >> 28)
+#define MM_UMP_GROUP(w0) (((uint32_t)(w0) >> 24) & 0x0F)
+
+/* Words in the packet that starts with w0, from its message type. */
+static inline uint32_t mm_ump_words(uint32_t w0)
+{
+    /* 2 bits per type, size - 1: 1 1 1 2 2 4 1 1 2 2 2 3 3 4 4 4 */
+    return ((0xFE950D40u >> (2 * (w0 >> 28))) & 3) + 1;
+}
+
+/* Enough output for any n bytes through mm_ump_encoder_feed: 2 words a
+   byte, plus one SysEx packet left pending by the previous call.          */
+#define MM_UMP_WORDS_FOR_BYTES(n) (2 * (size_t)(n) + 2)
+
+/* MIDI 2.0 value scaling. Up-scaling is the spec's min-centre-max rule:
+   0 → 0, the centre (64 of 7 bits) → the exact centre, the maximum → all
+   ones, with the low bits repeated above the centre so the curve stays
+   monotonic. Down-scaling drops low bits.                                 */
+uint32_t mm_ump_scale_up  (uint32_t value, unsigned src_bits, unsigned dst_bits);
+uint32_t mm_ump_scale_down(uint32_t value, unsigned src_bits, unsigned dst_bits);
+
+/* mm_message → UMP. Channel messages become MT 0x2 or 0x4 per proto,
+   system messages MT 0x1, SysEx (with or without its F0/F7) a run of MT 0x3
+   packets. Returns words written; 0 if msg has no UMP form or out is too
+   small, in which case nothing is written.                                 */
+size_t mm_ump_from_message (const mm_message* msg, mm_ump_protocol proto,
+                            uint32_t* out, size_t cap);
+/* Converts msgs in order until the next one won't fit. Returns how many
+   were consumed; *written gets the word count.                            */
+size_t mm_ump_from_messages(const mm_message* msgs, size_t n, mm_ump_protocol proto,
+                            uint32_t* out, size_t cap, size_t* written);
+
+/* MIDI 1.0 bytes → UMP, incrementally, on one group. Short messages go
+   through an embedded mm_parser (running status and all); SysEx is cut
+   into packets as it streams, so it needs no assembly buffer and has no
+   size limit. Its earlier packets are already out when a status byte cuts
+   it short, so that SysEx is closed there with the bytes it had.           */
+typedef struct mm_ump_encoder {
+    mm_parser       parser;
+    mm_ump_protocol protocol;
+    uint8_t         group;
+    uint8_t         sysex_state;   /* 0 none, 1 started, 2 packets sent  */
+    uint8_t         sysex_len;
+    uint8_t         sysex[6];      /* bytes of the packet being filled   */
+} mm_ump_encoder;
+
+void      mm_ump_encoder_init(mm_ump_encoder* e, mm_ump_protocol proto, uint8_t group);
+/* Writes at most cap words; MM_UMP_WORDS_FOR_BYTES(n) is always enough.
+   MM_OUT_OF_RANGE if output was dropped for lack of room.                 */
+mm_result mm_ump_encoder_feed(mm_ump_encoder* e, const uint8_t* bytes, size_t n,
+                              uint32_t* out, size_t cap, size_t* written);
+
+/* UMP → mm_message. MT 0x1/0x2 map one to one. MT 0x4 is scaled down;
+   a note-on whose velocity scales to 0 is sent with 1, a program change
+   with bank-valid set is preceded by CC 0 / 32, and registered / assignable
+   controllers become the CC 101/100 (99/98 for NRPN), 6, 38 sequence.
+   Per-note and relative controllers have no MIDI 1.0 form and are dropped,
+   as are MT 0x0, 0x5, 0xD and reserved types. SysEx7 is rebuilt with its
+   F0/F7 — a single-packet one needs no buffer, longer ones are assembled
+   in the caller's buffer and dropped if it is missing or too small. One
+   SysEx is assembled at a time; a start on another group replaces it.     */
+typedef struct mm_ump_decoder {
+    double   timestamp;      /* stamped on every emitted message            */
+    uint8_t* sysex;
+    size_t   sysex_cap;
+    size_t   sysex_len;
+    uint8_t  sysex_group;
+    uint8_t  in_sysex;       /* 1 = assembling, 2 = overflowed: dropping    */
+} mm_ump_decoder;
+
+void   mm_ump_decoder_init(mm_ump_decoder* d, uint8_t* sysex_buf, size_t sysex_cap);
+/* Returns words consumed: all of them, unless the last packet is cut short
+   (feed the rest again with the next call).                               */
+size_t mm_ump_decode(mm_ump_decoder* d, const uint32_t* words, size_t n,
+                     mm_parser_emit emit, void* userdata);
+
+/* UMP input (mm_in_set_ump_callback): one packet per call, words = 1–4.
+   Same thread and locking rules as mm_callback.                           */
+typedef void (*mm_ump_callback)(mm_device* dev, const uint32_t* ump, uint32_t words,
+                                double timestamp, void* userdata);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+   Clock tracking
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* Tempo and song position recovered from MIDI clock. The clocks drive a
+   second-order delay-locked loop (a PLL on tick times) whose bandwidth is
+   set in Hz, so smoothing is the same at any tempo: jitter averages out,
+   a real tempo change is followed within about 1 / bandwidth seconds.
+   After a (re)lock the loop runs 4x wider for a beat to pull in quickly;
+   a run of large errors in one direction — a tempo jump — re-widens it.
+   A gap of 2 … dropout_periods clocks counts the missing ones as lost,
+   so position stays right; a longer silence is a dropout and relocks the
+   phase, keeping the tempo.
+
+   Feed it from the input callback (one writer); read it from anywhere,
+   an audio thread included — mm_clock_tracker_read is a lock-free
+   seqlock copy: it never blocks, but retries while a push is mid-write.  */
+typedef struct mm_clock_info {
+    double   bpm;          /* smoothed tempo; 0 until locked                 */
+    double   period;       /* seconds per clock: 60 / (24 * bpm)             */
+    double   last_tick;    /* loop's time for the latest clock               */
+    double   next_tick;    /* predicted time of the next one                 */
+    double   position;     /* song position in quarter notes (SPP-aware)     */
+    double   phase;        /* 0 ≤ phase < 1 within the quarter note          */
+    double   jitter;       /* mean deviation of clocks from the loop, s      */
+    double   confidence;   /* 0 … 1: lock age, scaled down by jitter         */
+    uint32_t clocks;       /* clocks received                                */
+    uint32_t lost;         /* clocks inferred missing from short gaps        */
+    uint32_t dropouts;     /* silences longer than dropout_periods           */
+    int      running;      /* after START / CONTINUE, until STOP            */
+    int      locked;       /* tempo known                                    */
+    int      dropout;      /* read only: no clock for dropout_periods by now */
+} mm_clock_info;
+
+typedef struct mm_clock_tracker {
+    /* Settings: set after init, before the first push. */
+    double   bandwidth;        /* loop bandwidth, Hz; default 0.5           */
+    double   dropout_periods;  /* silence that is a dropout; default 12     */
+
+    /* Writer state. */
+    double   prev;             /* previous clock's raw timestamp            */
+    double   jitter;
+    uint32_t song_clock;       /* song position of the latest clock, or of
+                                  the next one while waiting; in clocks     */
+    uint32_t settle;           /* clocks since (re)lock                     */
+    int      streak;           /* consecutive gated errors, signed          */
+    int      waiting;          /* started, no clock yet: position holds     */
+
+    /* Published through the seqlock. */
+    uint32_t      seq;
+    mm_clock_info info;
+} mm_clock_tracker;
+
+void mm_clock_tracker_init(mm_clock_tracker* t);
+/* Takes MM_CLOCK, MM_START, MM_CONTINUE, MM_STOP, MM_SONG_POSITION and
+   MM_RESET, using msg->timestamp; anything else is ignored.               */
+void mm_clock_tracker_push(mm_clock_tracker* t, const mm_message* msg);
+/* now: the current time on the messages' clock (mm_in_time), to detect a
+   dropout as it happens and to advance position / phase past last_tick —
+   never by more than one clock. Pass 0 for the state as of last_tick.     */
+void mm_clock_tracker_read(const mm_clock_tracker* t, double now, mm_clock_info* out);
+
+/* MIDI clock out, timed by the kernel instead of a sleeping thread. The
+   master owns an ALSA queue at 24 ticks per quarter note, so a queue tick
+   is a MIDI clock: clocks are scheduled `window` ahead and the queue's
+   timer sends them, drift-free whatever our wakeup latency. A tempo change
+   is a queue event on the next clock, so clocks already scheduled follow
+   it. START / CONTINUE / locate also land on the next clock; a stop takes
+   back the clocks not yet played. Call mm_clock_master_refill at least
+   every window / 2 clocks at the fastest tempo you set: 60 ms at 1000 BPM
+   with the default 48. After a longer stall the missed clocks are skipped,
+   not sent in a burst. Drive a master from one thread. CoreMIDI, WinMM:
+   MM_NO_BACKEND.                                                          */
+typedef struct mm_clock_master {
+    mm_device* dev;          /* an open output: port, virtual or group     */
+    double     bpm;
+    uint32_t   window;       /* clocks kept scheduled; default 48 (2 beats) */
+    int        running;
+    int        queue;        /* ALSA queue; -1 = none                       */
+    uint32_t   next_tick;    /* queue tick of the next clock to schedule    */
+    uint32_t   song_clock;   /* its song position, in clocks                */
+} mm_clock_master;
+
+mm_result mm_clock_master_init     (mm_clock_master* m, mm_device* out, double bpm);
+mm_result mm_clock_master_uninit   (mm_clock_master* m);   /* stops first */
+mm_result mm_clock_master_start    (mm_clock_master* m);   /* from song position 0 */
+mm_result mm_clock_master_continue (mm_clock_master* m);
+mm_result mm_clock_master_stop     (mm_clock_master* m);
+/* Song position in MIDI beats (16ths), as MM_SONG_POSITION. While running
+   it is sent as STOP, SPP, CONTINUE on one clock boundary.                */
+mm_result mm_clock_master_locate   (mm_clock_master* m, uint16_t song_position);
+mm_result mm_clock_master_set_tempo(mm_clock_master* m, double bpm);   /* 10–1000 */
+mm_result mm_clock_master_refill   (mm_clock_master* m);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+   MIDI Time Code
+   ══════════════════════════════════════════════════════════════════════════ */
+
+/* MTC out as timestamped messages. Quarter frame q after a locate is due
+   at time + q / (4 · fps), computed from the locate, never summed, so a
+   late caller doesn't shift the phase: render ahead and queue each with
+   mm_out_send_at (or at an audio block's sample offsets), or send each as
+   it falls due. Pieces 0-7 go out four per frame and carry the frame
+   piece 0 went out on, so a message cycle is two frames. Any clock works
+   for time — mm_in_time, audio sample time — as long as it is one clock;
+   mm_out_send_at wants mm_in_time. Zero-initialise; nothing is rendered
+   before the first locate.                                                */
+typedef struct mm_mtc_generator {
+    mm_mtc_rate rate;
+    int         located;
+    double      origin;      /* time of quarter frame 0                     */
+    uint32_t    start;       /* its frame, counted from 00:00:00:00         */
+    uint32_t    quarter;     /* quarter frames rendered since the locate    */
+} mm_mtc_generator;
+
+/* Restart at timecode *f (at its rate) at `time`, piece 0 first. Fills
+   sysex, if not NULL, with the full-frame message to send right away.    */
+void   mm_mtc_generator_locate(mm_mtc_generator* g, const mm_mtc_frame* f,
+                               double time, uint8_t sysex[MM_MTC_FULL_FRAME_SIZE]);
+/* Quarter frames due before `until`, in order, as MM_MTC_QUARTER_FRAME
+   messages with timestamps; at most cap. Returns how many were written.  */
+size_t mm_mtc_generator_render(mm_mtc_generator* g, double until,
+                               mm_message* out, size_t cap);
+/* The frame showing at `time` (not before the locate). */
+void   mm_mtc_generator_position(const mm_mtc_generator* g, double time,
+                                 mm_mtc_frame* out);
+
+/* MTC in, chased. Pieces must arrive in order: 0 → 7 forward, 7 → 0 in
+   reverse; anything else is counted as an error and drops the lock until
+   a whole cycle comes in again. A cycle carries the frame its first piece
+   went out on, so the decoded time is two frames old when it completes
+   (the spec's 2-frame offset). After that, every quarter frame moves the
+   position a quarter frame on, or back. Full-frame SysEx locates at once.
+   No quarter frame for dropout_frames is a dropout: the position holds.
+
+   Feed it from the input callback (MM_MTC_QUARTER_FRAME, MM_SYSEX and
+   MM_RESET; one writer); read from any thread — mm_mtc_chaser_read is a
+   seqlock copy, like mm_clock_tracker_read.                               */
+typedef struct mm_mtc_chase_info {
+    double       position;   /* frames since 00:00:00:00, fractional        */
+    double       seconds;    /* position / fps                              */
+    double       speed;      /* measured: 1 = play, -1 = reverse, 0 = still */
+    double       anchor;     /* timestamp position was taken at             */
+    mm_mtc_frame frame;      /* whole frame at position, and the rate       */
+    int          direction;  /* +1, -1; 0 = stopped or not known yet        */
+    int          locked;     /* position known: a whole cycle or a locate   */
+    int          dropout;    /* read only: quarter frames have stopped      */
+    uint32_t     quarters;   /* quarter frames received                     */
+    uint32_t     errors;     /* pieces out of order                         */
+    uint32_t     dropouts;
+    uint32_t     locates;    /* full-frame messages                         */
+} mm_mtc_chase_info;
+
+typedef struct mm_mtc_chaser {
+    /* Setting: set after init, before the first push. */
+    double   dropout_frames;   /* silence that is a dropout; default 4     */
+
+    /* Writer state. */
+    uint8_t  pieces[8];
+    int      last;             /* previous piece; -1 = none                 */
+    int      run;              /* pieces of this cycle so far; -1 = waiting */
+    int      dir;
+    int      tracking;         /* base is valid                             */
+    uint32_t base;             /* frame of the current cycle's piece 0      */
+    double   prev;             /* previous quarter frame's raw timestamp    */
+    double   period;           /* filtered quarter-frame interval           */
+
+    /* Published through the seqlock. */
+    uint32_t          seq;
+    mm_mtc_chase_info info;
+} mm_mtc_chaser;
+
+void mm_mtc_chaser_init(mm_mtc_chaser* c);
+void mm_mtc_chaser_push(mm_mtc_chaser* c, const mm_message* msg);
+/* now: the current time on the messages' clock, to flag a dropout and to
+   move position on from anchor — by one quarter frame at most. Pass 0 for
+   the position at anchor.                                                 */
+void mm_mtc_chaser_read(const mm_mtc_chaser* c, double now, mm_mtc_chase_info* out);
+
 /* ══════════════════════════════════════════════════════════════════════════════
    Platform detection
    ══════════════════════════════════════════════════════════════════════════ */
@@ -381,14 +1338,44 @@ static inline mm_message mm_make_message(uint8_t status, uint8_t d1, uint8_t d2)
 #if defined(MM_BACKEND_COREMIDI)
 #  include <CoreMIDI/CoreMIDI.h>
 
-typedef struct { MIDIClientRef client; } mm__ctx_coremidi;
+typedef struct {
+    MIDIEndpointRef          src, dst;
+    MIDIThruConnectionRef    thru;
+} mm__cm_route;
+
+/* One endpoint of a multi-port virtual input; its address is the refCon. */
+typedef struct mm__cm_vport {
+    MIDIEndpointRef ep;
+    mm_device*      dev;
+    mm_parser       parser;     /* port_index = this port's index */
+} mm__cm_vport;
+
+typedef struct {
+    MIDIClientRef client;
+    mm__cm_route* routes;        /* grows up to config.max_routes */
+    uint32_t      route_count, route_cap;
+} mm__ctx_coremidi;
+
+/* MIDISendSysex is asynchronous: request and data must outlive the call.
+   buf points just past the struct, config.sysex_size + MM__CM_PL_SLACK
+   bytes. Virtual and group outputs use it as their packet list instead.  */
+#define MM__CM_PACKET_MAX 65535u   /* MIDIPacket.length is a UInt16 */
+#define MM__CM_PL_SLACK   64u      /* packet list + packet headers   */
+typedef struct mm__cm_sysex {
+    MIDISysexSendRequest req;
+    uint8_t*             buf;
+} mm__cm_sysex;
 
 typedef struct {
     MIDIPortRef          port;       /* non-virtual: the port we created     */
     MIDIEndpointRef      endpoint;   /* non-virtual: the hardware endpoint   */
     MIDIEndpointRef      virt_ep;    /* virtual: the endpoint we OWN        */
-    MIDISysexSendRequest sysex_req;
-    uint8_t              sysex_buf[MM_SYSEX_BUF_SIZE];
+    mm__cm_sysex*        sysex;      /* first mm_out_send_sysex allocates    */
+    MIDIEndpointRef*     members;    /* group: destination endpoints         */
+    mm__cm_vport*        vports;     /* multi-port virtual: owned endpoints  */
+    uint32_t             member_count, member_cap;
+    uint32_t             vport_count;
+    mm_parser            parser;     /* input bytes; sysex buf at start      */
 } mm__dev_coremidi;
 
 #elif defined(MM_BACKEND_WINMM)
@@ -399,36 +1386,102 @@ typedef struct {
 
 typedef struct { int dummy; } mm__ctx_winmm;
 
+/* Input sysex buffer handed to midiInAddBuffer; inputs only. buf points
+   just past the struct, config.sysex_size bytes.                          */
+typedef struct mm__wm_sysex {
+    MIDIHDR  hdr;
+    uint8_t* buf;
+} mm__wm_sysex;
+
 typedef struct {
-    HMIDIIN  in;
-    HMIDIOUT out;
-    MIDIHDR  sysex_hdr;
-    uint8_t  sysex_buf[MM_SYSEX_BUF_SIZE];
+    HMIDIIN       in;
+    HMIDIOUT      out;
+    mm__wm_sysex* sysex;
+    DWORD         start_ms;   /* timeGetTime at midiInStart: timestamps' zero */
 } mm__dev_winmm;
 
 #elif defined(MM_BACKEND_ALSA)
 #  include <alsa/asoundlib.h>
 #  include <pthread.h>
 #  include <poll.h>
+/* alsa-lib 1.2.10 added UMP (MIDI 2.0) sequencer clients. */
+#  if defined(SND_LIB_VERSION) && SND_LIB_VERSION >= 0x01020a
+#    define MM__ALSA_UMP
+#  endif
 
 /* ALSA sequencer API: all functions are inline wrappers in <alsa/asoundlib.h>
    over internal primitives — none are directly dlsym-able.
    We link -lasound directly, the same way macOS links -framework CoreMIDI.   */
 
+typedef struct mm__alsa_route { snd_seq_addr_t sender, dest; } mm__alsa_route;
+
+/* Dispatcher table entry: which device owns a port, and which of its ports. */
+typedef struct mm__alsa_slot { mm_device* dev; uint16_t index; } mm__alsa_slot;
+
+/* SysEx reassembly for one port. src is the sender of the message in
+   progress, so chunks from two apps feeding one port are never spliced.
+   buf points just past the struct, config.sysex_size bytes.               */
+typedef struct mm__alsa_sysex {
+    size_t         pos;
+    int            dropping;       /* overflowed: discard up to the F7      */
+    snd_seq_addr_t src;
+    uint8_t*       buf;
+} mm__alsa_sysex;
+
+/* One port of a multi-port virtual input, with its own sysex reassembly. */
+typedef struct mm__alsa_vport {
+    int             port_id;
+    mm__alsa_sysex* sysex;
+    mm_ump_decoder* ump;
+} mm__alsa_vport;
+
 typedef struct mm__ctx_alsa {
-    snd_seq_t* seq;
-    int        client_id;
+    snd_seq_t*     seq;
+    int            client_id;
+    int            ump;         /* UMP client: MM_UMP_PROTOCOL_*; 0 = MIDI 1.0 */
+    int            queue;       /* for routes, mm_out_send_at; -1 = none yet */
+    mm__alsa_route* routes;     /* grows up to config.max_routes */
+    uint32_t       route_count, route_cap;
+    /* One receive thread per context drains the handle and dispatches each
+       event to the device owning ev->dest.port (port ids are 0–255). In
+       MM_DELIVERY_POLL there is no thread; mm_context_dispatch drains.    */
+    pthread_t       thread;
+    int             thread_running;
+    int             wake_pipe[2];   /* [0]=read [1]=write, used to unblock poll() */
+    struct pollfd*  pfds;           /* built before the thread starts / at init */
+    int             nfds;
+    pthread_mutex_t lock;           /* guards slots; held around callbacks   */
+    pthread_t       cb_thread;      /* who is running callbacks, while ...   */
+    volatile int    in_callback;    /* ... this is set (under lock)          */
+    mm__alsa_slot   slots[256];
 } mm__ctx_alsa;
 
+/* Registry watch: a second sequencer handle subscribed to System:Announce,
+   so announce traffic never mixes with device input on the context handle. */
+typedef struct mm__reg_alsa {
+    snd_seq_t*      seq;
+    int             client_id;
+    int             port_id;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    int             wake_pipe[2];
+    struct pollfd*  pfds;
+    int             nfds;
+} mm__reg_alsa;
+
+/* Hot fields first; sysex storage is allocated per input port at
+   mm_in_start (config.lazy_sysex: on the first chunk), never for outputs. */
 typedef struct mm__dev_alsa {
-    int            port_id;
-    int            target_client;
-    int            target_port;
-    pthread_t      thread;
-    volatile int   running;
-    int            wake_pipe[2];   /* [0]=read [1]=write, used to unblock poll() */
-    uint8_t        sysex_buf[MM_SYSEX_BUF_SIZE];
-    size_t         sysex_pos;
+    int             port_id;
+    int             running;       /* registered with the context dispatcher */
+    mm__alsa_sysex* sysex;         /* input reassembly; made at start        */
+    mm_ump_decoder* ump;           /* UMP client: UMP → mm_message, ditto    */
+    mm__alsa_vport* vports;        /* multi-port virtual: one per port       */
+    uint32_t        vport_count;
+    int             target_client;
+    int             target_port;
+    uint32_t        member_count, member_cap;
+    snd_seq_addr_t* members;       /* group: subscribed destinations         */
 } mm__dev_alsa;
 
 #endif /* backends */
@@ -438,6 +1491,8 @@ typedef struct mm__dev_alsa {
    ══════════════════════════════════════════════════════════════════════════ */
 
 struct mm_context {
+    mm_allocation_callbacks alloc;   /* always filled in after init */
+    mm_context_config       config;  /* resolved: no zero defaults left */
 #if defined(MM_BACKEND_COREMIDI)
     mm__ctx_coremidi cm;
 #elif defined(MM_BACKEND_WINMM)
@@ -449,6 +1504,8 @@ struct mm_context {
     char name[64];   /* app name shown to other MIDI clients (CoreMIDI, ALSA) */
 };
 
+/* Receive-path fields lead; SysEx storage lives behind a pointer and is only
+   allocated when a device actually sends or receives SysEx.                */
 struct mm_device {
     mm_context* ctx;
     mm_callback callback;
@@ -456,6 +1513,11 @@ struct mm_device {
     int         is_input;
     int         is_open;
     int         is_virtual;  /* 1 = opened with mm_in/out_open_virtual */
+    int         is_group;    /* 1 = opened with mm_out_open_group      */
+    mm_ump_callback ump_callback;   /* mm_in_set_ump_callback             */
+    void*           ump_userdata;
+    mm_ump_decoder* ump_out;        /* mm_out_send_ump translation state;
+                                       NULL until first used              */
 #if defined(MM_BACKEND_COREMIDI)
     mm__dev_coremidi cm;
 #elif defined(MM_BACKEND_WINMM)
@@ -477,6 +1539,15 @@ struct mm_device {
 mm_result   mm_context_init  (mm_context* ctx, const char* name);
 mm_result   mm_context_uninit(mm_context* ctx);
 
+/* Same as mm_context_init, with the full configuration. config may be NULL. */
+mm_context_config mm_context_config_init(void);
+mm_result   mm_context_init_ex(mm_context* ctx, const mm_context_config* config);
+
+/* MM_DELIVERY_POLL only: wait up to timeout_ms (0 = don't block, -1 =
+   forever) for input, then run every pending callback on this thread.
+   dispatched (may be NULL) receives the number of events handled.          */
+mm_result   mm_context_dispatch(mm_context* ctx, int timeout_ms, uint32_t* dispatched);
+
 uint32_t    mm_in_count (mm_context* ctx);
 mm_result   mm_in_name  (mm_context* ctx, uint32_t idx, char* buf, size_t bufsz);
 uint32_t    mm_out_count(mm_context* ctx);
@@ -488,6 +1559,11 @@ mm_result   mm_in_start (mm_device* dev);
 mm_result   mm_in_stop  (mm_device* dev);
 mm_result   mm_in_close (mm_device* dev);
 
+/* Now, on the clock this input stamps msg->timestamp with — to measure
+   against message timestamps from another thread (mm_clock_tracker_read).
+   CoreMIDI: host time; WinMM: time since mm_in_start; ALSA: monotonic.   */
+double      mm_in_time  (const mm_device* dev);
+
 /* Virtual input: creates a named destination that OTHER apps can connect to
    and send MIDI into. VMPK, DAWs, etc. will see it in their output lists.
    mm_in_start / mm_in_stop / mm_in_close work identically to the normal path.
@@ -496,16 +1572,213 @@ mm_result   mm_in_close (mm_device* dev);
 mm_result   mm_in_open_virtual(mm_context* ctx, mm_device* dev,
                                 mm_callback cb, void* userdata);
 
+/* Multi-port virtual input: `count` named virtual destinations on ONE device,
+   serviced by one thread. names may be NULL ("<client name>-1" …). Every
+   message carries msg->port_index (0 … count-1) to tell the ports apart.
+   Start/stop/close act on all ports at once.
+   On Windows/WinMM returns MM_NO_BACKEND.                                  */
+mm_result   mm_in_open_virtual_multi(mm_context* ctx, mm_device* dev,
+                                     const char* const* names, uint32_t count,
+                                     mm_callback cb, void* userdata);
+
 mm_result   mm_out_open      (mm_context* ctx, mm_device* dev, uint32_t idx);
 mm_result   mm_out_send      (mm_device* dev, const mm_message* msg);
 mm_result   mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size);
 mm_result   mm_out_close     (mm_device* dev);
 
+/* mm_out_send, due at `time` on the mm_in_time clock (any device's); a
+   time already past sends at once. ALSA: scheduled on the context's
+   timestamp queue, which the first call allocates. CoreMIDI: the packet's
+   timestamp — MIDISend holds it until then, but a virtual output's readers
+   get it at once, stamped. WinMM can't schedule: MM_NO_BACKEND.          */
+mm_result   mm_out_send_at   (mm_device* dev, const mm_message* msg, double time);
+
+/* ── MIDI 2.0 (UMP) I/O ───────────────────────────────────────────────────
+   config.ump asks for a UMP sequencer client: ALSA, alsa-lib 1.2.10+ and a
+   kernel with UMP support (6.5+). mm_context_is_ump says whether it was
+   granted. The calls below work either way: on a UMP client packets pass
+   through untouched, anywhere else they are translated with mm_ump_*
+   (MIDI 1.0 ↔ UMP, using config.ump's protocol, MIDI 1.0 if unset).        */
+int         mm_context_is_ump(const mm_context* ctx);
+
+/* Deliver input as UMP packets instead of mm_messages. Call after open,
+   before mm_in_start.                                                      */
+mm_result   mm_in_set_ump_callback(mm_device* dev, mm_ump_callback cb, void* userdata);
+
+/* Send complete packets; a packet cut short at the end is MM_INVALID_ARG
+   and nothing is sent.                                                     */
+mm_result   mm_out_send_ump(mm_device* dev, const uint32_t* words, size_t n);
+
 /* Virtual output: creates a named source that OTHER apps can read from.
    Use mm_out_send / mm_out_send_sysex to push messages out to subscribers.
    On Windows/WinMM returns MM_NO_BACKEND (see note above).                  */
 mm_result   mm_out_open_virtual(mm_context* ctx, mm_device* dev);
 
+/* Output group: one device that broadcasts every mm_out_send /
+   mm_out_send_sysex to all of its members. Starts empty; members are output
+   indices (as for mm_out_open) and can be added or removed at any time.
+   mm_out_close disconnects all members.
+   On ALSA the fan-out happens in the kernel: one event and one syscall per
+   send regardless of member count.
+   On Windows/WinMM returns MM_NO_BACKEND.                                  */
+mm_result   mm_out_open_group  (mm_context* ctx, mm_device* dev);
+mm_result   mm_out_group_add   (mm_device* dev, uint32_t out_idx);
+mm_result   mm_out_group_remove(mm_device* dev, uint32_t out_idx);
+
+/* ── Bulk open ─────────────────────────────────────────────────────────────────
+   Open `count` devices in one call: devs[i] gets port idx[i] (or the registry
+   entry ports[i]), all inputs sharing one callback. results is optional; if
+   given it receives each device's own result, and a device that failed is
+   left closed. Returns MM_SUCCESS if every device opened, otherwise the first
+   failure. mm_in_start_many / mm_in_stop_many act on a whole array.
+   On ALSA the indices are resolved in a single walk of the port tree, and
+   every input — bulk or not — is serviced by the context's one receive
+   thread, so opening 32 inputs adds no threads and no pipes.               */
+mm_result   mm_in_open_many (mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                             uint32_t count, mm_callback cb, void* userdata,
+                             mm_result* results);
+mm_result   mm_out_open_many(mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                             uint32_t count, mm_result* results);
+mm_result   mm_in_start_many(mm_device* devs, uint32_t count);
+mm_result   mm_in_stop_many (mm_device* devs, uint32_t count);
+
+/* ── Kernel-level routing ──────────────────────────────────────────────────────
+   Connect an external input port straight to an external output port, e.g.
+   hardware keyboard → hardware synth. The OS moves the events; nothing passes
+   through this process, so there is no callback and no thread.
+   in_idx / out_idx are the indices used by mm_in_name / mm_out_name.
+   Routes still connected at mm_context_uninit are disconnected there.
+   On CoreMIDI this is a non-persistent MIDIThruConnection and the options are
+   ignored. On Windows/WinMM returns MM_NO_BACKEND.                           */
+
+typedef enum mm_route_flags {
+    MM_ROUTE_EXCLUSIVE      = 1 << 0,  /* refuse further subscribers on this pair */
+    MM_ROUTE_TIMESTAMP      = 1 << 1,  /* stamp events with queue time (ticks)    */
+    MM_ROUTE_TIMESTAMP_REAL = 1 << 2,  /* stamp with real time (implies TIMESTAMP) */
+} mm_route_flags;
+
+typedef struct mm_route_options {
+    uint32_t flags;   /* MM_ROUTE_* bits                                       */
+    int      queue;   /* ALSA queue used for MM_ROUTE_TIMESTAMP*; -1 lets the
+                         context allocate (and later free) its own queue       */
+} mm_route_options;
+
+/* opts may be NULL: plain, non-exclusive, no timestamps.
+   Returns MM_ALREADY_OPEN if the two ports are already connected.            */
+mm_result   mm_route_connect   (mm_context* ctx, uint32_t in_idx, uint32_t out_idx,
+                                const mm_route_options* opts);
+mm_result   mm_route_disconnect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx);
+
+/* ── Port registry ─────────────────────────────────────────────────────────────
+   A snapshot of every port, enumerated in one pass. mm_in_count / mm_in_name
+   re-enumerate on every call (on ALSA that walks every client and port in the
+   kernel); a registry does it once, then lookups are plain array loads.
+   Indices into reg->in / reg->out are the mm_in_* / mm_out_* indices at the
+   time of the snapshot. Call mm_registry_refresh to pick up changes.
+   Strings and arrays are owned by the registry and stay valid until the next
+   refresh or uninit.                                                          */
+
+typedef enum mm_port_flags {
+    MM_PORT_INPUT  = 1 << 0,   /* listed by mm_in_*:  we can receive from it */
+    MM_PORT_OUTPUT = 1 << 1,   /* listed by mm_out_*: we can send to it      */
+} mm_port_flags;
+
+typedef struct mm_port_info {
+    const char* name;    /* same string mm_in_name / mm_out_name return       */
+    int         client;  /* ALSA client id; -1 on CoreMIDI / WinMM             */
+    int         port;    /* ALSA port id; endpoint / device index elsewhere    */
+    uint32_t    flags;   /* MM_PORT_INPUT | MM_PORT_OUTPUT                     */
+    uint32_t    caps;    /* ALSA SND_SEQ_PORT_CAP_* bits; 0 elsewhere          */
+    uint32_t    type;    /* ALSA SND_SEQ_PORT_TYPE_* bits; 0 elsewhere         */
+} mm_port_info;
+
+typedef enum mm_port_event {
+    MM_PORT_ADDED   = 1,
+    MM_PORT_REMOVED = 2,
+    MM_PORT_CHANGED = 3,   /* name, capabilities or type changed */
+} mm_port_event;
+
+typedef struct mm_port_registry mm_port_registry;
+
+/* Called on the watch thread with the registry lock held. port is valid only
+   for the duration of the call; for MM_PORT_REMOVED it is the entry as it was
+   just before removal. Do not call mm_registry_* from inside.               */
+typedef void (*mm_port_callback)(mm_port_registry* reg, mm_port_event event,
+                                 const mm_port_info* port, void* userdata);
+
+struct mm_port_registry {
+    mm_context*   ctx;
+    mm_port_info* ports;      /* every port, enumeration order               */
+    uint32_t      count, capacity;
+    uint32_t*     in;         /* mm_in_*  index → ports[]                    */
+    uint32_t      in_count;
+    uint32_t*     out;        /* mm_out_* index → ports[]                    */
+    uint32_t      out_count;
+    uint32_t      index_cap;  /* allocated length of in / out                */
+    char*         names;      /* interned name storage for ports[].name      */
+    char*         names_spare;/* same size: live names are compacted into it */
+    size_t        names_size, names_cap;
+    uint32_t      dropped;    /* watch updates that did not fit the reserve  */
+    int           fixed;      /* set on the watch thread: no allocation      */
+    int              watching;   /* 1 while mm_registry_watch is active       */
+    mm_port_callback watch_cb;
+    void*            watch_userdata;
+#if defined(MM_BACKEND_ALSA)
+    mm__reg_alsa     al;
+#endif
+};
+
+mm_result   mm_registry_init   (mm_context* ctx, mm_port_registry* reg);
+mm_result   mm_registry_refresh(mm_port_registry* reg);
+void        mm_registry_uninit (mm_port_registry* reg);
+
+/* O(1). NULL if idx is out of range. */
+const mm_port_info* mm_registry_in (const mm_port_registry* reg, uint32_t idx);
+const mm_port_info* mm_registry_out(const mm_port_registry* reg, uint32_t idx);
+
+/* O(log n) lookup by address, e.g. a message's source_client/source_port.
+   NULL if the registry has no such port (or either part is -1).            */
+const mm_port_info* mm_registry_find(const mm_port_registry* reg, int client, int port);
+
+/* Hotplug: keep the registry current as ports come and go, and optionally get
+   told about each change (cb may be NULL). While watched, the registry is
+   updated from a background thread: bracket reads with mm_registry_lock /
+   mm_registry_unlock, and do not hold on to mm_port_info pointers across
+   them. Indices shift as ports are added and removed. The watch thread
+   never allocates: each refresh reserves room for MM_REGISTRY_RESERVE more
+   ports, and an update that does not fit is skipped and counted in
+   reg->dropped — refresh (on your thread) to catch up and re-reserve.
+   Linux: System:Announce subscription, incremental updates.
+   macOS / Windows: returns MM_NO_BACKEND.                                   */
+mm_result   mm_registry_watch  (mm_port_registry* reg, mm_port_callback cb, void* userdata);
+mm_result   mm_registry_unwatch(mm_port_registry* reg);
+void        mm_registry_lock   (mm_port_registry* reg);
+void        mm_registry_unlock (mm_port_registry* reg);
+
+/* Open by something that survives hotplug instead of a volatile index.
+   spec is tried, in order, as:
+     - an ALSA address, "client:port" with client numeric or a client name
+       ("20:0", "VMPK Output:0"), resolved by one targeted query (Linux only)
+     - a glob (* and ?) over the full port names mm_in_name / mm_out_name
+       return ("*FluidSynth*", "USB MIDI*:* (*:1)"); first match wins.
+   Returns MM_OUT_OF_RANGE if nothing matches.                               */
+mm_result   mm_in_open_by_address (mm_context* ctx, mm_device* dev, const char* spec,
+                                   mm_callback cb, void* userdata);
+mm_result   mm_out_open_by_address(mm_context* ctx, mm_device* dev, const char* spec);
+
+/* Open straight from a registry entry — no enumeration. */
+mm_result   mm_in_open_port (mm_context* ctx, mm_device* dev, const mm_port_info* port,
+                             mm_callback cb, void* userdata);
+mm_result   mm_out_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port);
+
+/* Bulk variants of the above; see mm_in_open_many. No enumeration at all. */
+mm_result   mm_in_open_many_ports (mm_context* ctx, mm_device* devs,
+                                   const mm_port_info* const* ports, uint32_t count,
+                                   mm_callback cb, void* userdata, mm_result* results);
+mm_result   mm_out_open_many_ports(mm_context* ctx, mm_device* devs,
+                                   const mm_port_info* const* ports, uint32_t count,
+                                   mm_result* results);
+
 const char* mm_result_string(mm_result r);
 
 /* ══════════════════════════════════════════════════════════════════════════════
@@ -528,255 +1801,1936 @@ const char* mm_result_string(mm_result r) {
     return mm__result_strings[i];
 }
 
-/* ─────────────────────────────────────────────────────────────────────────────
-   CoreMIDI (macOS / iOS)
-   ───────────────────────────────────────────────────────────────────────── */
-#if defined(MM_BACKEND_COREMIDI)
+/* ── Allocation ──────────────────────────────────────────────────────────── */
 
-#include <mach/mach_time.h>
+static void* mm__default_malloc(size_t sz, void* ud)           { (void)ud; return malloc(sz); }
+static void* mm__default_realloc(void* p, size_t sz, void* ud) { (void)ud; return realloc(p, sz); }
+static void  mm__default_free(void* p, void* ud)               { (void)ud; free(p); }
 
-static double mm__cm_ts(MIDITimeStamp ts) {
-    static mach_timebase_info_data_t tb; static int init=0;
-    if (!init) { mach_timebase_info(&tb); init=1; }
-    return (double)ts * tb.numer / tb.denom * 1e-9;
+static void* mm__malloc(const mm_context* ctx, size_t sz) {
+    return ctx->alloc.on_malloc(sz, ctx->alloc.user_data);
+}
+static void* mm__calloc(const mm_context* ctx, size_t n, size_t sz) {
+    if (sz && n > (size_t)-1 / sz) return NULL;
+    void* p = ctx->alloc.on_malloc(n * sz, ctx->alloc.user_data);
+    if (p) memset(p, 0, n * sz);
+    return p;
+}
+static void* mm__realloc(const mm_context* ctx, void* p, size_t sz) {
+    return ctx->alloc.on_realloc(p, sz, ctx->alloc.user_data);
+}
+static void mm__free(const mm_context* ctx, void* p) {
+    if (p) ctx->alloc.on_free(p, ctx->alloc.user_data);
 }
 
-static void mm__cm_read_proc(const MIDIPacketList* pl, void* ref, void* src)
+mm_context_config mm_context_config_init(void) {
+    mm_context_config c;
+    memset(&c, 0, sizeof(c));
+    c.sysex_size = MM_SYSEX_BUF_SIZE;
+    c.max_routes = MM_MAX_ROUTES;
+    return c;
+}
+
+/* Shared front half of every backend's mm_context_init_ex. */
+static mm_result mm__context_setup(mm_context* ctx, const mm_context_config* config) {
+    mm_context_config c = config ? *config : mm_context_config_init();
+    const mm_allocation_callbacks* a = &c.allocation_callbacks;
+    int set = (a->on_malloc != NULL) + (a->on_realloc != NULL) + (a->on_free != NULL);
+    if (set != 0 && set != 3) return MM_INVALID_ARG;
+    if (c.delivery != MM_DELIVERY_THREAD && c.delivery != MM_DELIVERY_POLL)
+        return MM_INVALID_ARG;
+    memset(ctx, 0, sizeof(*ctx));
+    if (set) ctx->alloc = *a;
+    else {
+        ctx->alloc.on_malloc  = mm__default_malloc;
+        ctx->alloc.on_realloc = mm__default_realloc;
+        ctx->alloc.on_free    = mm__default_free;
+    }
+    strncpy(ctx->name, (c.name && c.name[0]) ? c.name : "minimidio", sizeof(ctx->name)-1);
+    if (!c.sysex_size) c.sysex_size = MM_SYSEX_BUF_SIZE;
+    if (!c.max_routes) c.max_routes = MM_MAX_ROUTES;
+    c.name = ctx->name;
+    c.allocation_callbacks = ctx->alloc;
+    ctx->config = c;
+    return MM_SUCCESS;
+}
+
+#if !defined(MM_BACKEND_WINMM)
+/* Make room for one more route in a growable array, up to max_routes. */
+static mm_result mm__route_reserve(mm_context* ctx, void** routes, uint32_t count,
+                                   uint32_t* cap, size_t elem)
 {
-    mm_device* dev = (mm_device*)ref; (void)src;
-    if (!dev || !dev->callback) return;
+    if (count >= ctx->config.max_routes) return MM_ALLOC_FAILED;
+    if (count < *cap) return MM_SUCCESS;
+    uint32_t ncap = *cap ? *cap * 2 : 8;
+    if (ncap > ctx->config.max_routes) ncap = ctx->config.max_routes;
+    void* p = mm__realloc(ctx, *routes, (size_t)ncap * elem);
+    if (!p) return MM_ALLOC_FAILED;
+    *routes = p; *cap = ncap;
+    return MM_SUCCESS;
+}
+#endif
 
-    const MIDIPacket* pkt = &pl->packet[0];
-    for (UInt32 i = 0; i < pl->numPackets; i++) {
-        size_t j = 0;
-        while (j < pkt->length) {
-            uint8_t s  = pkt->data[j];
-            double  ts = mm__cm_ts(pkt->timeStamp);
-            mm_message msg; memset(&msg, 0, sizeof(msg)); msg.timestamp = ts;
-
-            /* System real-time — single byte, may appear mid-packet */
-            if (s >= 0xF8) {
-                switch (s) {
-                    case 0xF8: msg.type = MM_CLOCK;        break;
-                    case 0xFA: msg.type = MM_START;        break;
-                    case 0xFB: msg.type = MM_CONTINUE;     break;
-                    case 0xFC: msg.type = MM_STOP;         break;
-                    case 0xFE: msg.type = MM_ACTIVE_SENSE; break;
-                    case 0xFF: msg.type = MM_RESET;        break;
-                    default:   j++; continue; /* 0xF4/F5/F9/FD undefined */
-                }
-                dev->callback(dev, &msg, dev->userdata); j++; continue;
-            }
+mm_result mm_context_init(mm_context* ctx, const char* name) {
+    mm_context_config c = mm_context_config_init();
+    c.name = name;
+    return mm_context_init_ex(ctx, &c);
+}
 
-            /* SysEx */
-            if (s == 0xF0) {
-                size_t start = j;
-                while (j < pkt->length && pkt->data[j] != 0xF7) j++;
-                if (j < pkt->length) j++;
-                msg.type = MM_SYSEX; msg.sysex = &pkt->data[start];
-                msg.sysex_size = j - start;
-                dev->callback(dev, &msg, dev->userdata); continue;
-            }
+/* ── Status-byte scanning ────────────────────────────────────────────────────
+   Status bytes are exactly the bytes with the top bit set, so x86 finds
+   them with one movemask per vector. Define MM_NO_SIMD to force the
+   portable 8-bytes-per-step loop.                                          */
+
+#if !defined(MM_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define MM__SIMD_X86
+#  include <emmintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+#    include <immintrin.h>
+#    define MM__AVX2_TARGET __attribute__((target("avx2")))
+#    define MM__SIMD_AVX2
+#  elif defined(_MSC_VER)
+#    include <immintrin.h>
+#    include <intrin.h>
+#    define MM__AVX2_TARGET
+#    define MM__SIMD_AVX2
+#  endif
+#endif
 
-            /* System common 0xF1–0xF6 */
-            if (s >= 0xF1 && s <= 0xF6) {
-                j++;
-                switch (s) {
-                    case 0xF1:
-                        msg.type = MM_MTC_QUARTER_FRAME;
-                        if (j < pkt->length) msg.data[0] = pkt->data[j++];
-                        dev->callback(dev, &msg, dev->userdata); break;
-                    case 0xF2:
-                        msg.type = MM_SONG_POSITION;
-                        if (j + 1 < pkt->length) {
-                            uint8_t lsb = pkt->data[j++];
-                            uint8_t msb = pkt->data[j++];
-                            msg.song_position = (uint16_t)(lsb | ((uint16_t)msb << 7));
-                            msg.data[0] = lsb; msg.data[1] = msb;
-                        }
-                        dev->callback(dev, &msg, dev->userdata); break;
-                    case 0xF3:
-                        msg.type = MM_SONG_SELECT;
-                        if (j < pkt->length) msg.data[0] = pkt->data[j++];
-                        dev->callback(dev, &msg, dev->userdata); break;
-                    case 0xF6:
-                        msg.type = MM_TUNE_REQUEST;
-                        dev->callback(dev, &msg, dev->userdata); break;
-                    default: break; /* 0xF4, 0xF5 undefined */
-                }
-                continue;
-            }
+/* Portable: test 8 bytes at once, then find the byte within the word. */
+static size_t mm__scan_status_swar(const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w; memcpy(&w, b + i, 8);
+        if (w & 0x8080808080808080ull) break;
+    }
+    for (; i < n; i++) if (b[i] & 0x80) break;
+    return i;
+}
 
-            /* Channel messages 0x80–0xEF */
-            if (s >= 0x80) {
-                msg.type    = (mm_message_type)((s >> 4) & 0x0F);
-                msg.channel = s & 0x0F; j++;
-                if (j < pkt->length) msg.data[0] = pkt->data[j++];
-                switch (msg.type) {
-                    case MM_NOTE_OFF: case MM_NOTE_ON: case MM_POLY_PRESSURE:
-                    case MM_CONTROL_CHANGE: case MM_PITCH_BEND:
-                        if (j < pkt->length) msg.data[1] = pkt->data[j++]; break;
-                    default: break;
-                }
-                dev->callback(dev, &msg, dev->userdata); continue;
-            }
-            j++; /* running status byte / unknown — skip */
-        }
-        pkt = MIDIPacketNext(pkt);
+#ifdef MM__SIMD_X86
+static unsigned mm__ctz32(uint32_t m) {
+#  if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i; _BitScanForward(&i, m); return (unsigned)i;
+#  else
+    return (unsigned)__builtin_ctz(m);
+#  endif
+}
+
+static size_t mm__scan_status_sse2(const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int m = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (m) return i + mm__ctz32((uint32_t)m);
     }
+    return i + mm__scan_status_swar(b + i, n - i);
 }
+#endif
 
-mm_result mm_context_init(mm_context* ctx, const char* name) {
-    if (!ctx) return MM_INVALID_ARG;
-    memset(ctx, 0, sizeof(*ctx));
-    strncpy(ctx->name, (name && name[0]) ? name : "minimidio", sizeof(ctx->name)-1);
-    CFStringRef cfname = CFStringCreateWithCString(NULL, ctx->name, kCFStringEncodingUTF8);
-    OSStatus st = MIDIClientCreate(cfname, NULL, NULL, &ctx->cm.client);
-    CFRelease(cfname);
-    if (st != noErr) return MM_ERROR;
-    ctx->initialized = 1; return MM_SUCCESS;
+#ifdef MM__SIMD_AVX2
+MM__AVX2_TARGET
+static size_t mm__scan_status_avx2(const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        int m = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(b + i)));
+        if (m) return i + mm__ctz32((uint32_t)m);
+    }
+    return i + mm__scan_status_sse2(b + i, n - i);
 }
-mm_result mm_context_uninit(mm_context* ctx) {
-    if (!ctx || !ctx->initialized) return MM_INVALID_ARG;
-    MIDIClientDispose(ctx->cm.client); ctx->initialized = 0; return MM_SUCCESS;
+
+static int mm__cpu_avx2(void) {
+#  if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#  else
+    /* CPUID.7:EBX.AVX2, and the OS must save YMM state (XCR0 bits 1-2). */
+    static int cached = -1;
+    if (cached < 0) {
+        int r[4];
+        __cpuid(r, 1);
+        int osxsave = (r[2] >> 27) & 1;
+        __cpuidex(r, 7, 0);
+        cached = ((r[1] >> 5) & 1) && osxsave && ((_xgetbv(0) & 6) == 6);
+    }
+    return cached;
+#  endif
 }
+#endif
 
-uint32_t mm_in_count (mm_context* ctx) { (void)ctx; return (uint32_t)MIDIGetNumberOfSources();      }
-uint32_t mm_out_count(mm_context* ctx) { (void)ctx; return (uint32_t)MIDIGetNumberOfDestinations();  }
+size_t mm_scan_status(const uint8_t* bytes, size_t n) {
+#if defined(MM__SIMD_AVX2)
+    if (n >= 32 && mm__cpu_avx2()) return mm__scan_status_avx2(bytes, n);
+#endif
+#if defined(MM__SIMD_X86)
+    if (n >= 16) return mm__scan_status_sse2(bytes, n);
+#endif
+    return mm__scan_status_swar(bytes, n);
+}
 
-static mm_result mm__cm_name(MIDIEndpointRef ep, char* buf, size_t sz) {
-    CFStringRef n = NULL;
-    MIDIObjectGetStringProperty(ep, kMIDIPropertyDisplayName, &n);
-    if (!n) MIDIObjectGetStringProperty(ep, kMIDIPropertyName, &n);
-    if (!n) { snprintf(buf, sz, "(unknown)"); return MM_ERROR; }
-    CFStringGetCString(n, buf, (CFIndex)sz, kCFStringEncodingUTF8);
-    CFRelease(n); return MM_SUCCESS;
+const char* mm_scan_backend(void) {
+#if defined(MM__SIMD_AVX2)
+    if (mm__cpu_avx2()) return "avx2";
+#endif
+#if defined(MM__SIMD_X86)
+    return "sse2";
+#else
+    return "swar";
+#endif
 }
-mm_result mm_in_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
-    (void)ctx;
-    if (idx >= MIDIGetNumberOfSources()) return MM_OUT_OF_RANGE;
-    return mm__cm_name(MIDIGetSource(idx), buf, sz);
+
+/* ── Packed messages ─────────────────────────────────────────────────────────
+   The ring needs acquire/release on head and tail only. C11 <stdatomic.h>
+   is off-limits in a header that must also compile as C++, so use the
+   compiler builtins.                                                       */
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#  include <intrin.h>
+/* Interlocked ops are full barriers on every MSVC target, ARM64 included. */
+static uint32_t mm__load_acquire(const uint32_t* p) {
+    return (uint32_t)_InterlockedCompareExchange((volatile long*)p, 0, 0);
 }
-mm_result mm_out_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
-    (void)ctx;
-    if (idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
-    return mm__cm_name(MIDIGetDestination(idx), buf, sz);
+static void mm__store_release(uint32_t* p, uint32_t v) {
+    _InterlockedExchange((volatile long*)p, (long)v);
 }
+#else
+static uint32_t mm__load_acquire(const uint32_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void mm__store_release(uint32_t* p, uint32_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#endif
 
-mm_result mm_in_open(mm_context* ctx, mm_device* dev, uint32_t idx,
-                     mm_callback cb, void* ud)
+size_t mm_pack_messages(const mm_message* in, size_t n, double base_time,
+                        mm_packed_message* out)
 {
-    if (!ctx||!dev||!cb) return MM_INVALID_ARG;
-    if (idx >= MIDIGetNumberOfSources()) return MM_OUT_OF_RANGE;
-    memset(dev, 0, sizeof(*dev));
-    dev->ctx=ctx; dev->callback=cb; dev->userdata=ud; dev->is_input=1;
-    dev->cm.endpoint = MIDIGetSource(idx);
-    char portname[80]; snprintf(portname, sizeof(portname), "%s-in", ctx->name);
-    CFStringRef cfport = CFStringCreateWithCString(NULL, portname, kCFStringEncodingUTF8);
-    OSStatus st = MIDIInputPortCreate(ctx->cm.client, cfport,
-                                      mm__cm_read_proc, dev, &dev->cm.port);
-    CFRelease(cfport);
-    if (st != noErr) return MM_ERROR;
-    dev->is_open=1; return MM_SUCCESS;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) k += (size_t)mm_pack(&in[i], base_time, &out[k]);
+    return k;
 }
-mm_result mm_in_start(mm_device* dev) {
-    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
-    if (dev->is_virtual) return MM_SUCCESS; /* CoreMIDI: other apps connect to us */
-    return (MIDIPortConnectSource(dev->cm.port, dev->cm.endpoint, NULL) == noErr)
-           ? MM_SUCCESS : MM_ERROR;
+
+void mm_unpack_messages(const mm_packed_message* in, size_t n, double base_time,
+                        mm_message* out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = mm_unpack(&in[i], base_time);
 }
-mm_result mm_in_stop(mm_device* dev) {
-    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
-    if (dev->is_virtual) return MM_SUCCESS;
-    MIDIPortDisconnectSource(dev->cm.port, dev->cm.endpoint); return MM_SUCCESS;
+
+mm_result mm_packed_ring_init(mm_packed_ring* r, mm_packed_message* storage,
+                              uint32_t capacity, double base_time)
+{
+    if (!r || !storage || capacity < 2 || (capacity & (capacity - 1))) return MM_INVALID_ARG;
+    memset(r, 0, sizeof(*r));
+    r->buf       = storage;
+    r->mask      = capacity - 1;
+    r->base_time = base_time;
+    return MM_SUCCESS;
 }
-mm_result mm_in_close(mm_device* dev) {
-    if (!dev||!dev->is_open) return MM_NOT_OPEN;
-    mm_in_stop(dev);
-    if (dev->is_virtual)
-        MIDIEndpointDispose(dev->cm.virt_ep);
-    else
-        MIDIPortDispose(dev->cm.port);
-    dev->is_open=0; return MM_SUCCESS;
+
+/* head and tail run freely and wrap at 2^32; head - tail is the fill. */
+uint32_t mm_packed_ring_push(mm_packed_ring* r, const mm_packed_message* msgs, uint32_t count)
+{
+    uint32_t head = r->head;
+    uint32_t room = r->mask + 1 - (head - mm__load_acquire(&r->tail));
+    if (count > room) count = room;
+    for (uint32_t i = 0; i < count; i++) r->buf[(head + i) & r->mask] = msgs[i];
+    mm__store_release(&r->head, head + count);
+    return count;
 }
 
-mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
-    if (!ctx||!dev) return MM_INVALID_ARG;
-    if (idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
-    memset(dev, 0, sizeof(*dev)); dev->ctx=ctx; dev->is_input=0;
-    dev->cm.endpoint = MIDIGetDestination(idx);
-    char portname[80]; snprintf(portname, sizeof(portname), "%s-out", ctx->name);
-    CFStringRef cfport = CFStringCreateWithCString(NULL, portname, kCFStringEncodingUTF8);
-    OSStatus st = MIDIOutputPortCreate(ctx->cm.client, cfport, &dev->cm.port);
-    CFRelease(cfport);
-    if (st != noErr) return MM_ERROR;
-    dev->is_open=1; return MM_SUCCESS;
+uint32_t mm_packed_ring_pop(mm_packed_ring* r, mm_packed_message* out, uint32_t max)
+{
+    uint32_t tail  = r->tail;
+    uint32_t avail = mm__load_acquire(&r->head) - tail;
+    if (max > avail) max = avail;
+    for (uint32_t i = 0; i < max; i++) out[i] = r->buf[(tail + i) & r->mask];
+    mm__store_release(&r->tail, tail + max);
+    return max;
 }
 
-mm_result mm_out_send(mm_device* dev, const mm_message* msg) {
-    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
-    if (!msg) return MM_INVALID_ARG;
-    uint8_t raw[3]; int len=1;
-    switch (msg->type) {
-        case MM_NOTE_OFF: case MM_NOTE_ON: case MM_POLY_PRESSURE:
-        case MM_CONTROL_CHANGE: case MM_PITCH_BEND:
-            raw[0]=(uint8_t)(((uint8_t)msg->type<<4)|(msg->channel&0xF));
-            raw[1]=msg->data[0]; raw[2]=msg->data[1]; len=3; break;
-        case MM_PROGRAM_CHANGE: case MM_CHANNEL_PRESSURE:
-            raw[0]=(uint8_t)(((uint8_t)msg->type<<4)|(msg->channel&0xF));
-            raw[1]=msg->data[0]; len=2; break;
-        case MM_SONG_POSITION:
-            raw[0]=0xF2; raw[1]=(uint8_t)(msg->song_position&0x7F);
-            raw[2]=(uint8_t)((msg->song_position>>7)&0x7F); len=3; break;
-        case MM_MTC_QUARTER_FRAME: raw[0]=0xF1; raw[1]=msg->data[0]; len=2; break;
-        case MM_SONG_SELECT:       raw[0]=0xF3; raw[1]=msg->data[0]; len=2; break;
-        case MM_TUNE_REQUEST:      raw[0]=0xF6; len=1; break;
-        case MM_CLOCK:             raw[0]=0xF8; len=1; break;
-        case MM_START:             raw[0]=0xFA; len=1; break;
-        case MM_CONTINUE:          raw[0]=0xFB; len=1; break;
-        case MM_STOP:              raw[0]=0xFC; len=1; break;
-        case MM_ACTIVE_SENSE:      raw[0]=0xFE; len=1; break;
-        case MM_RESET:             raw[0]=0xFF; len=1; break;
-        default: return MM_INVALID_ARG;
-    }
-    MIDIPacketList pl; MIDIPacket* p = MIDIPacketListInit(&pl);
-    p = MIDIPacketListAdd(&pl, sizeof(pl), p, 0, (ByteCount)len, raw);
-    if (!p) return MM_ERROR;
-    if (dev->is_virtual)
-        return (MIDIReceived(dev->cm.virt_ep, &pl) == noErr) ? MM_SUCCESS : MM_ERROR;
-    return (MIDISend(dev->cm.port, dev->cm.endpoint, &pl) == noErr) ? MM_SUCCESS : MM_ERROR;
+uint32_t mm_packed_ring_count(const mm_packed_ring* r) {
+    return mm__load_acquire(&r->head) - mm__load_acquire(&r->tail);
 }
 
-mm_result mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size) {
-    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
-    if (!data||!size||size>MM_SYSEX_BUF_SIZE) return MM_INVALID_ARG;
-    memcpy(dev->cm.sysex_buf, data, size);
-    if (dev->is_virtual) {
-        /* Virtual source: push sysex as a packet directly to subscribers */
-        MIDIPacketList pl; MIDIPacket* p = MIDIPacketListInit(&pl);
-        p = MIDIPacketListAdd(&pl, sizeof(pl), p, 0, (ByteCount)size,
-                              dev->cm.sysex_buf);
-        if (!p) return MM_ERROR;
-        return (MIDIReceived(dev->cm.virt_ep, &pl) == noErr) ? MM_SUCCESS : MM_ERROR;
+int mm_packed_ring_push_message(mm_packed_ring* r, const mm_message* msg) {
+    mm_packed_message p;
+    if (!mm_pack(msg, r->base_time, &p)) return 0;
+    return (int)mm_packed_ring_push(r, &p, 1);
+}
+
+/* ── Event batches ───────────────────────────────────────────────────────── */
+
+mm_result mm_event_batch_init(mm_event_batch* b, const mm_allocation_callbacks* callbacks,
+                              size_t capacity)
+{
+    if (!b) return MM_INVALID_ARG;
+    memset(b, 0, sizeof(*b));
+    if (callbacks && (callbacks->on_malloc || callbacks->on_realloc || callbacks->on_free)) {
+        if (!callbacks->on_malloc || !callbacks->on_realloc || !callbacks->on_free)
+            return MM_INVALID_ARG;
+        b->alloc = *callbacks;
+    } else {
+        b->alloc.on_malloc  = mm__default_malloc;
+        b->alloc.on_realloc = mm__default_realloc;
+        b->alloc.on_free    = mm__default_free;
     }
-    dev->cm.sysex_req.destination      = dev->cm.endpoint;
-    dev->cm.sysex_req.data             = dev->cm.sysex_buf;
-    dev->cm.sysex_req.bytesToSend      = (UInt32)size;
-    dev->cm.sysex_req.complete         = false;
-    dev->cm.sysex_req.completionProc   = NULL;
-    dev->cm.sysex_req.completionRefCon = NULL;
-    return (MIDISendSysex(&dev->cm.sysex_req) == noErr) ? MM_SUCCESS : MM_ERROR;
+    return capacity ? mm_event_batch_reserve(b, capacity) : MM_SUCCESS;
 }
-mm_result mm_out_close(mm_device* dev) {
+
+void mm_event_batch_uninit(mm_event_batch* b) {
+    if (!b || !b->alloc.on_free) return;
+    void* cols[8] = { b->timestamp, b->status, b->data1, b->data2,
+                      b->port_index, b->sysex_offset, b->sysex_size, b->payload };
+    for (int i = 0; i < 8; i++) if (cols[i]) b->alloc.on_free(cols[i], b->alloc.user_data);
+    memset(b, 0, sizeof(*b));
+}
+
+void mm_event_batch_clear(mm_event_batch* b) { b->count = 0; b->payload_size = 0; }
+
+/* Grow one column. On failure the column keeps its old (still valid) size. */
+static int mm__batch_grow(mm_event_batch* b, void** col, size_t bytes) {
+    void* p = b->alloc.on_realloc(*col, bytes, b->alloc.user_data);
+    if (!p) return 0;
+    *col = p; return 1;
+}
+
+mm_result mm_event_batch_reserve(mm_event_batch* b, size_t capacity) {
+    if (capacity <= b->capacity) return MM_SUCCESS;
+    /* Every column must make it before capacity moves; columns that did grow
+       are merely roomier than needed if a later one fails.                 */
+    if (!mm__batch_grow(b, (void**)&b->timestamp,    capacity * sizeof(double))   ||
+        !mm__batch_grow(b, (void**)&b->status,       capacity)                    ||
+        !mm__batch_grow(b, (void**)&b->data1,        capacity)                    ||
+        !mm__batch_grow(b, (void**)&b->data2,        capacity)                    ||
+        !mm__batch_grow(b, (void**)&b->port_index,   capacity * sizeof(uint16_t)) ||
+        !mm__batch_grow(b, (void**)&b->sysex_offset, capacity * sizeof(uint32_t)) ||
+        !mm__batch_grow(b, (void**)&b->sysex_size,   capacity * sizeof(uint32_t)))
+        return MM_ALLOC_FAILED;
+    b->capacity = capacity;
+    return MM_SUCCESS;
+}
+
+static mm_result mm__batch_room(mm_event_batch* b, size_t n) {
+    if (b->count + n <= b->capacity) return MM_SUCCESS;
+    size_t cap = b->capacity ? b->capacity * 2 : 256;
+    while (cap < b->count + n) cap *= 2;
+    return mm_event_batch_reserve(b, cap);
+}
+
+mm_result mm_event_batch_append(mm_event_batch* b, const mm_message* msgs, size_t n) {
+    if (!b || (!msgs && n)) return MM_INVALID_ARG;
+    size_t sx = 0;
+    for (size_t i = 0; i < n; i++) if (msgs[i].type == MM_SYSEX) sx += msgs[i].sysex_size;
+    if (sx && b->payload_size + sx > 0xFFFFFFFFu) return MM_OUT_OF_RANGE;
+    if (mm__batch_room(b, n) != MM_SUCCESS) return MM_ALLOC_FAILED;
+    if (b->payload_size + sx > b->payload_capacity) {
+        size_t cap = b->payload_capacity ? b->payload_capacity * 2 : 4096;
+        while (cap < b->payload_size + sx) cap *= 2;
+        if (!mm__batch_grow(b, (void**)&b->payload, cap)) return MM_ALLOC_FAILED;
+        b->payload_capacity = cap;
+    }
+    size_t k = b->count;
+    for (size_t i = 0; i < n; i++, k++) {
+        const mm_message* m = &msgs[i];
+        uint8_t raw[3] = { 0, 0, 0 };
+        b->timestamp[k]    = m->timestamp;
+        b->port_index[k]   = m->port_index;
+        b->sysex_offset[k] = 0;
+        b->sysex_size[k]   = 0;
+        if (m->type == MM_SYSEX) {
+            raw[0] = 0xF0;
+            if (m->sysex_size) memcpy(b->payload + b->payload_size, m->sysex, m->sysex_size);
+            b->sysex_offset[k] = (uint32_t)b->payload_size;
+            b->sysex_size[k]   = (uint32_t)m->sysex_size;
+            b->payload_size   += m->sysex_size;
+        } else {
+            mm__encode(m, raw);   /* invalid types land as status 0 */
+        }
+        b->status[k] = raw[0]; b->data1[k] = raw[1]; b->data2[k] = raw[2];
+    }
+    b->count = k;
+    return MM_SUCCESS;
+}
+
+mm_result mm_event_batch_append_packed(mm_event_batch* b, const mm_packed_message* msgs,
+                                       size_t n, double base_time)
+{
+    if (!b || (!msgs && n)) return MM_INVALID_ARG;
+    if (mm__batch_room(b, n) != MM_SUCCESS) return MM_ALLOC_FAILED;
+    /* Straight column splits: no branches, so the compiler vectorizes. */
+    double*   ts = b->timestamp  + b->count;
+    uint8_t*  st = b->status     + b->count;
+    uint8_t*  d1 = b->data1      + b->count;
+    uint8_t*  d2 = b->data2      + b->count;
+    uint16_t* pi = b->port_index + b->count;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t w = msgs[i].word;
+        ts[i] = base_time + (double)msgs[i].time * 1e-6;
+        st[i] = (uint8_t)w;
+        d1[i] = (uint8_t)(w >> 8);
+        d2[i] = (uint8_t)(w >> 16);
+        pi[i] = (uint16_t)(w >> 24);
+    }
+    memset(b->sysex_offset + b->count, 0, n * sizeof(uint32_t));
+    memset(b->sysex_size   + b->count, 0, n * sizeof(uint32_t));
+    b->count += n;
+    return MM_SUCCESS;
+}
+
+mm_message mm_event_batch_get(const mm_event_batch* b, size_t i) {
+    mm_message m = mm__decode(b->status[i], b->data1[i], b->data2[i]);
+    if (b->status[i] == 0xF0) {
+        m.sysex      = b->payload + b->sysex_offset[i];
+        m.sysex_size = b->sysex_size[i];
+    }
+    m.timestamp  = b->timestamp[i];
+    m.port_index = b->port_index[i];
+    return m;
+}
+
+/* ── Batch kernels ───────────────────────────────────────────────────────────
+   Scalar versions are the reference; vector versions run whole vectors and
+   leave the tail to the scalar code. A kernel with no SSE2 form needs a
+   byte shuffle, which SSE2 lacks (pshufb is SSSE3).                        */
+
+void mm_filter_init(mm_filter* f, uint32_t type_mask, uint16_t channel_mask) {
+    memset(f, 0, sizeof(*f));
+    for (int s = 0x80; s < 256; s++) {
+        const mm__status_info si = mm__status_table[s];
+        if (!si.type || !(type_mask & MM_TYPE_BIT(si.type))) continue;
+        if ((si.flags & MM__ST_CHANNEL) && !(channel_mask & (1u << (s & 0x0F)))) continue;
+        f->bits[s >> 3] |= (uint8_t)(1u << (s & 7));
+    }
+}
+
+static int mm__filter_pass(const mm_filter* f, uint8_t s) {
+    return (f->bits[s >> 3] >> (s & 7)) & 1;
+}
+
+static void mm__batch_move(mm_event_batch* b, size_t to, size_t from) {
+    b->timestamp[to]    = b->timestamp[from];
+    b->status[to]       = b->status[from];
+    b->data1[to]        = b->data1[from];
+    b->data2[to]        = b->data2[from];
+    b->port_index[to]   = b->port_index[from];
+    b->sysex_offset[to] = b->sysex_offset[from];
+    b->sysex_size[to]   = b->sysex_size[from];
+}
+
+/* Scalar kernels over byte columns, from index i on. The filter copies
+   every event and advances only on a pass: no data-dependent branch.      */
+static size_t mm__filter_scalar(mm_event_batch* b, const mm_filter* f, size_t i, size_t k) {
+    for (; i < b->count; i++)
+        { mm__batch_move(b, k, i); k += (size_t)mm__filter_pass(f, b->status[i]); }
+    return k;
+}
+static void mm__remap_scalar(uint8_t* st, size_t i, size_t n, const uint8_t map[16]) {
+    for (; i < n; i++) {
+        uint8_t s = st[i];
+        if (s >= 0x80 && s < 0xF0) st[i] = (uint8_t)((s & 0xF0) | (map[s & 0x0F] & 0x0F));
+    }
+}
+static void mm__transpose_scalar(const uint8_t* st, uint8_t* d1, size_t i, size_t n, int semis) {
+    for (; i < n; i++) {
+        uint8_t hi = st[i] & 0xF0;
+        if (hi < 0x80 || hi > 0xA0) continue;
+        int v = d1[i] + semis;
+        d1[i] = (uint8_t)(v < 0 ? 0 : v > 127 ? 127 : v);
+    }
+}
+static void mm__velocity_scalar(const uint8_t* st, uint8_t* d2, size_t i, size_t n,
+                                const uint8_t lut[128]) {
+    for (; i < n; i++)
+        if ((st[i] & 0xF0) == 0x90 && d2[i]) d2[i] = lut[d2[i] & 0x7F];
+}
+
+#ifdef MM__SIMD_X86
+static size_t mm__transpose_sse2(const uint8_t* st, uint8_t* d1, size_t n, int semis) {
+    const __m128i hi_mask = _mm_set1_epi8((char)0xF0);
+    const __m128i up  = _mm_set1_epi8((char)(semis > 0 ?  semis : 0));
+    const __m128i dn  = _mm_set1_epi8((char)(semis < 0 ? -semis : 0));
+    const __m128i top = _mm_set1_epi8(127);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s  = _mm_loadu_si128((const __m128i*)(st + i));
+        __m128i v  = _mm_loadu_si128((const __m128i*)(d1 + i));
+        __m128i hi = _mm_and_si128(s, hi_mask);
+        __m128i m  = _mm_or_si128(_mm_or_si128(
+                        _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)0x80)),
+                        _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)0x90))),
+                        _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)0xA0)));
+        __m128i t  = _mm_min_epu8(_mm_subs_epu8(_mm_adds_epu8(v, up), dn), top);
+        _mm_storeu_si128((__m128i*)(d1 + i),
+                         _mm_or_si128(_mm_and_si128(m, t), _mm_andnot_si128(m, v)));
+    }
+    return i;
+}
+#endif
+
+#ifdef MM__SIMD_AVX2
+MM__AVX2_TARGET
+static size_t mm__transpose_avx2(const uint8_t* st, uint8_t* d1, size_t n, int semis) {
+    const __m256i hi_mask = _mm256_set1_epi8((char)0xF0);
+    const __m256i up  = _mm256_set1_epi8((char)(semis > 0 ?  semis : 0));
+    const __m256i dn  = _mm256_set1_epi8((char)(semis < 0 ? -semis : 0));
+    const __m256i top = _mm256_set1_epi8(127);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s  = _mm256_loadu_si256((const __m256i*)(st + i));
+        __m256i v  = _mm256_loadu_si256((const __m256i*)(d1 + i));
+        __m256i hi = _mm256_and_si256(s, hi_mask);
+        __m256i m  = _mm256_or_si256(_mm256_or_si256(
+                        _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)0x80)),
+                        _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)0x90))),
+                        _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)0xA0)));
+        __m256i t  = _mm256_min_epu8(_mm256_subs_epu8(_mm256_adds_epu8(v, up), dn), top);
+        _mm256_storeu_si256((__m256i*)(d1 + i), _mm256_blendv_epi8(v, t, m));
+    }
+    return i;
+}
+
+/* Channel messages: status 0x80–0xEF. */
+MM__AVX2_TARGET
+static size_t mm__remap_avx2(uint8_t* st, size_t n, const uint8_t map[16]) {
+    uint8_t m16[16];
+    for (int c = 0; c < 16; c++) m16[c] = map[c] & 0x0F;
+    const __m256i tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m16));
+    const __m256i lo  = _mm256_set1_epi8(0x0F);
+    const __m256i hi_mask = _mm256_set1_epi8((char)0xF0);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s  = _mm256_loadu_si256((const __m256i*)(st + i));
+        __m256i hi = _mm256_and_si256(s, hi_mask);
+        /* top bit set (signed < 0) and not 0xF_ */
+        __m256i ch = _mm256_andnot_si256(_mm256_cmpeq_epi8(hi, hi_mask),
+                                         _mm256_cmpgt_epi8(_mm256_setzero_si256(), s));
+        __m256i ns = _mm256_or_si256(hi, _mm256_shuffle_epi8(tbl, _mm256_and_si256(s, lo)));
+        _mm256_storeu_si256((__m256i*)(st + i), _mm256_blendv_epi8(s, ns, ch));
+    }
+    return i;
+}
+
+/* 128-entry byte LUT as eight 16-entry pshufb tables, picked by idx >> 4. */
+MM__AVX2_TARGET
+static size_t mm__velocity_avx2(const uint8_t* st, uint8_t* d2, size_t n, const uint8_t lut[128]) {
+    __m256i tbl[8];
+    for (int k = 0; k < 8; k++)
+        tbl[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(lut + 16 * k)));
+    const __m256i lo = _mm256_set1_epi8(0x0F);
+    const __m256i hi_mask = _mm256_set1_epi8((char)0xF0);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s   = _mm256_loadu_si256((const __m256i*)(st + i));
+        __m256i v   = _mm256_loadu_si256((const __m256i*)(d2 + i));
+        __m256i idx = _mm256_and_si256(v, _mm256_set1_epi8(0x7F));
+        __m256i blk = _mm256_and_si256(_mm256_srli_epi16(idx, 4), lo);
+        __m256i sub = _mm256_and_si256(idx, lo);
+        __m256i out = _mm256_setzero_si256();
+        for (int k = 0; k < 8; k++)
+            out = _mm256_or_si256(out, _mm256_and_si256(
+                      _mm256_cmpeq_epi8(blk, _mm256_set1_epi8((char)k)),
+                      _mm256_shuffle_epi8(tbl[k], sub)));
+        __m256i m = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()),
+                        _mm256_cmpeq_epi8(_mm256_and_si256(s, hi_mask),
+                                          _mm256_set1_epi8((char)0x90)));
+        _mm256_storeu_si256((__m256i*)(d2 + i), _mm256_blendv_epi8(v, out, m));
+    }
+    return i;
+}
+
+/* Pass bits for 32 statuses per step into keep[]. Compaction happens in
+   the caller, outside AVX code: mixing 256-bit ops with the scalar column
+   copies here costs a state transition per copy.                          */
+MM__AVX2_TARGET
+static void mm__filter_mask_avx2(const uint8_t* st, size_t steps, const mm_filter* f,
+                                 uint32_t* keep) {
+    static const uint8_t pow2[16] = { 1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128 };
+    const __m256i t0  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)f->bits));
+    const __m256i t1  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(f->bits + 16)));
+    const __m256i bit = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pow2));
+    const __m256i b16 = _mm256_set1_epi8(0x10);
+    for (size_t c = 0; c < steps; c++) {
+        __m256i s    = _mm256_loadu_si256((const __m256i*)(st + 32 * c));
+        __m256i byte = _mm256_and_si256(_mm256_srli_epi16(s, 3), _mm256_set1_epi8(0x1F));
+        __m256i sub  = _mm256_and_si256(byte, _mm256_set1_epi8(0x0F));
+        __m256i word = _mm256_blendv_epi8(_mm256_shuffle_epi8(t0, sub), _mm256_shuffle_epi8(t1, sub),
+                                          _mm256_cmpeq_epi8(_mm256_and_si256(byte, b16), b16));
+        __m256i want = _mm256_shuffle_epi8(bit, _mm256_and_si256(s, _mm256_set1_epi8(7)));
+        keep[c] = ~(uint32_t)_mm256_movemask_epi8(
+                      _mm256_cmpeq_epi8(_mm256_and_si256(word, want), _mm256_setzero_si256()));
+    }
+}
+#endif
+
+size_t mm_event_batch_filter(mm_event_batch* b, const mm_filter* f) {
+    size_t i = 0, k = 0;
+#ifdef MM__SIMD_AVX2
+    /* Runs where every event passes and nothing has been dropped yet cost
+       no stores at all.                                                  */
+    if (mm__cpu_avx2()) {
+        uint32_t keep[64];
+        while (b->count - i >= 32) {
+            size_t steps = (b->count - i) / 32;
+            if (steps > 64) steps = 64;
+            mm__filter_mask_avx2(b->status + i, steps, f, keep);
+            for (size_t c = 0; c < steps; c++, i += 32) {
+                if (keep[c] == 0xFFFFFFFFu && k == i) { k += 32; continue; }
+                for (uint32_t j = 0; j < 32; j++) {
+                    mm__batch_move(b, k, i + j);
+                    k += (keep[c] >> j) & 1;
+                }
+            }
+        }
+    }
+#endif
+    b->count = mm__filter_scalar(b, f, i, k);
+    /* Payload bytes of dropped SysEx stay in the blob until clear. */
+    return b->count;
+}
+
+void mm_event_batch_remap(mm_event_batch* b, const uint8_t map[16]) {
+    size_t i = 0;
+#ifdef MM__SIMD_AVX2
+    if (mm__cpu_avx2()) i = mm__remap_avx2(b->status, b->count, map);
+#endif
+    mm__remap_scalar(b->status, i, b->count, map);
+}
+
+void mm_event_batch_transpose(mm_event_batch* b, int semitones) {
+    if (semitones < -127) semitones = -127;
+    if (semitones >  127) semitones =  127;
+    size_t i = 0;
+#if defined(MM__SIMD_AVX2)
+    if (mm__cpu_avx2()) i = mm__transpose_avx2(b->status, b->data1, b->count, semitones);
+    else
+#endif
+#if defined(MM__SIMD_X86)
+    i = mm__transpose_sse2(b->status, b->data1, b->count, semitones);
+#endif
+    mm__transpose_scalar(b->status, b->data1, i, b->count, semitones);
+}
+
+void mm_event_batch_velocity(mm_event_batch* b, const uint8_t lut[128]) {
+    size_t i = 0;
+#ifdef MM__SIMD_AVX2
+    if (mm__cpu_avx2()) i = mm__velocity_avx2(b->status, b->data2, b->count, lut);
+#endif
+    mm__velocity_scalar(b->status, b->data2, i, b->count, lut);
+}
+
+/* Packed forms: the status is the low byte of word, data1 the next, data2
+   the one after.                                                          */
+size_t mm_packed_filter(mm_packed_message* msgs, size_t n, const mm_filter* f) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        msgs[k] = msgs[i];
+        k += (size_t)mm__filter_pass(f, (uint8_t)msgs[i].word);
+    }
+    return k;
+}
+
+void mm_packed_remap(mm_packed_message* msgs, size_t n, const uint8_t map[16]) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t w = msgs[i].word; uint8_t s = (uint8_t)w;
+        if (s >= 0x80 && s < 0xF0)
+            msgs[i].word = (w & ~0x0Fu) | (map[s & 0x0F] & 0x0Fu);
+    }
+}
+
+void mm_packed_transpose(mm_packed_message* msgs, size_t n, int semitones) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t w = msgs[i].word; uint8_t hi = (uint8_t)w & 0xF0;
+        if (hi < 0x80 || hi > 0xA0) continue;
+        int v = (int)((w >> 8) & 0x7F) + semitones;
+        v = v < 0 ? 0 : v > 127 ? 127 : v;
+        msgs[i].word = (w & ~0xFF00u) | ((uint32_t)v << 8);
+    }
+}
+
+void mm_packed_velocity(mm_packed_message* msgs, size_t n, const uint8_t lut[128]) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t w = msgs[i].word; uint8_t v = (uint8_t)(w >> 16) & 0x7F;
+        if (((uint8_t)w & 0xF0) == 0x90 && v)
+            msgs[i].word = (w & ~0xFF0000u) | ((uint32_t)lut[v] << 16);
+    }
+}
+
+/* ── Byte-stream parser ──────────────────────────────────────────────────── */
+
+void mm_parser_init(mm_parser* p, uint8_t* sysex_buf, size_t sysex_cap) {
+    memset(p, 0, sizeof(*p));
+    p->sysex     = sysex_buf;
+    p->sysex_cap = sysex_buf ? sysex_cap : 0;
+}
+
+void mm_parser_reset(mm_parser* p) {
+    p->sysex_len = 0;
+    p->running = p->status = 0;
+    p->have = p->need = 0;
+    p->in_sysex = 0;
+}
+
+static void mm__parser_emit(const mm_parser* p, mm_message* m,
+                            mm_parser_emit emit, void* ud)
+{
+    m->timestamp     = p->timestamp;
+    m->port_index    = p->port_index;
+    m->source_client = m->source_port = -1;
+    emit(m, ud);
+}
+
+/* Append to the SysEx buffer, switching to "dropping" when it won't fit. */
+static void mm__parser_sysex_put(mm_parser* p, const uint8_t* d, size_t n) {
+    if (p->in_sysex != 1) return;
+    if (!p->sysex || n > p->sysex_cap - p->sysex_len) { p->in_sysex = 2; return; }
+    memcpy(p->sysex + p->sysex_len, d, n);
+    p->sysex_len += n;
+}
+
+void mm_parser_feed(mm_parser* p, const uint8_t* bytes, size_t n,
+                    mm_parser_emit emit, void* userdata)
+{
+    const size_t none = (size_t)-1;
+    size_t run = none;   /* start of a SysEx still contiguous in bytes[] */
+    mm_message m;
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = bytes[i];
+
+        /* Real-time: delivered at once, leaves every other state alone. */
+        if (b >= 0xF8) {
+            /* Cut a contiguous SysEx here even for F9/FD, which are then
+               dropped: the run must not carry them into the message.    */
+            if (run != none) { mm__parser_sysex_put(p, bytes + run, i - run); run = none; }
+            if (!mm__status_table[b].type) continue;   /* F9, FD undefined */
+            m = mm__decode(b, 0, 0);
+            mm__parser_emit(p, &m, emit, userdata);
+            continue;
+        }
+
+        if (p->in_sysex) {
+            if (b < 0x80) {
+                /* Skip the whole data run in one go; SysEx is where the
+                   long runs are.                                         */
+                size_t end = i + mm_scan_status(bytes + i, n - i);
+                if (run == none) mm__parser_sysex_put(p, bytes + i, end - i);
+                i = end - 1;
+                continue;
+            }
+            if (b == 0xF7) {
+                memset(&m, 0, sizeof(m));
+                m.type = MM_SYSEX;
+                if (run != none) {
+                    m.sysex = bytes + run; m.sysex_size = i + 1 - run;
+                    mm__parser_emit(p, &m, emit, userdata);
+                } else {
+                    mm__parser_sysex_put(p, &b, 1);
+                    if (p->in_sysex == 1) {
+                        m.sysex = p->sysex; m.sysex_size = p->sysex_len;
+                        mm__parser_emit(p, &m, emit, userdata);
+                    }
+                }
+                p->in_sysex = 0; p->sysex_len = 0; run = none;
+                continue;
+            }
+            /* Any other status byte ends the SysEx unterminated: drop it. */
+            p->in_sysex = 0; p->sysex_len = 0; run = none;
+        }
+
+        if (b == 0xF0) {
+            p->in_sysex = 1; p->sysex_len = 0; run = i;
+            p->running = p->status = 0;
+            continue;
+        }
+
+        if (b >= 0x80) {
+            /* Channel status sets running status; system common clears it. */
+            const mm__status_info si = mm__status_table[b];
+            p->running = (si.flags & MM__ST_CHANNEL) ? b : 0;
+            p->status  = si.type ? b : 0;   /* F4 F5 F7: nothing to collect */
+            p->have    = 0;
+            p->need    = si.len;
+            if (!si.type || si.len) continue;
+            p->data[0] = p->data[1] = 0;
+        } else {
+            if (!p->status) {
+                if (!p->running) continue;   /* orphan data byte */
+                p->status = p->running; p->have = 0;
+                p->need   = mm__status_table[p->running].len;
+            }
+            p->data[p->have++] = b;
+            if (p->have < p->need) continue;
+        }
+
+        /* Message complete. */
+        m = mm__decode(p->status, p->data[0], p->data[1]);
+        p->status = 0; p->have = 0;
+        mm__parser_emit(p, &m, emit, userdata);
+    }
+
+    /* SysEx continues in the next feed: keep what this one carried. */
+    if (run != none) mm__parser_sysex_put(p, bytes + run, n - run);
+}
+
+/* ── Universal MIDI Packets ─────────────────────────────────────────────── */
+
+uint32_t mm_ump_scale_up(uint32_t value, unsigned src_bits, unsigned dst_bits) {
+    if (src_bits == 0 || src_bits >= dst_bits || dst_bits > 32) return value;
+    const unsigned scale  = dst_bits - src_bits;
+    const unsigned repeat = src_bits - 1;
+    uint32_t out = value << scale;
+    if (value <= (1u << repeat) || repeat == 0) return out;
+    /* Above the centre: fill the new low bits with the value's own low
+       bits, repeated, so the maximum lands on all ones.                    */
+    uint32_t r = value & ((1u << repeat) - 1);
+    r = (scale > repeat) ? r << (scale - repeat) : r >> (repeat - scale);
+    for (; r; r >>= repeat) out |= r;
+    return out;
+}
+
+uint32_t mm_ump_scale_down(uint32_t value, unsigned src_bits, unsigned dst_bits) {
+    if (dst_bits >= src_bits) return value;
+    return value >> (src_bits - dst_bits);
+}
+
+/* One short message as MT 0x1 / 0x2 / 0x4. Returns words (1 or 2), 0 if
+   there is no short form.                                                 */
+static size_t mm__ump_short(const mm_message* msg, mm_ump_protocol proto, uint32_t group,
+                            uint32_t out[2])
+{
+    uint8_t b[3];
+    if (msg->type == MM_SYSEX || !mm__encode(msg, b)) return 0;
+    const uint32_t st = b[0], d1 = b[1] & 0x7F, d2 = b[2] & 0x7F;
+    const uint32_t hdr = (group & 0x0F) << 24 | st << 16;
+    if (st >= 0xF0)                      { out[0] = 0x10000000u | hdr | d1 << 8 | d2; return 1; }
+    if (proto != MM_UMP_PROTOCOL_MIDI2)  { out[0] = 0x20000000u | hdr | d1 << 8 | d2; return 1; }
+
+    out[0] = 0x40000000u | hdr;
+    switch (st & 0xF0) {
+    case 0x90:
+        if (d2 == 0) {   /* note-on velocity 0 is a note-off */
+            out[0] = 0x40000000u | (group & 0x0F) << 24 | (0x80u | (st & 0x0F)) << 16 | d1 << 8;
+            out[1] = 0;
+            return 2;
+        }
+        /* fall through */
+    case 0x80: out[0] |= d1 << 8; out[1] = mm_ump_scale_up(d2, 7, 16) << 16;        break;
+    case 0xA0:
+    case 0xB0: out[0] |= d1 << 8; out[1] = mm_ump_scale_up(d2, 7, 32);              break;
+    case 0xC0:                    out[1] = d1 << 24;                                break;
+    case 0xD0:                    out[1] = mm_ump_scale_up(d1, 7, 32);              break;
+    default:                      out[1] = mm_ump_scale_up(d1 | d2 << 7, 14, 32);   break;
+    }
+    return 2;
+}
+
+static uint32_t mm__ump_sysex_packet(uint32_t group, uint32_t status, const uint8_t* d,
+                                     unsigned n, uint32_t out[2])
+{
+    uint8_t p[6] = { 0, 0, 0, 0, 0, 0 };
+    memcpy(p, d, n);
+    out[0] = 0x30000000u | (group & 0x0F) << 24 | status << 20 | (uint32_t)n << 16
+           | (uint32_t)p[0] << 8 | p[1];
+    out[1] = (uint32_t)p[2] << 24 | (uint32_t)p[3] << 16 | (uint32_t)p[4] << 8 | p[5];
+    return 2;
+}
+
+/* SysEx body without its F0/F7 framing. */
+static const uint8_t* mm__ump_sysex_body(const mm_message* msg, size_t* len) {
+    const uint8_t* d = msg->sysex;
+    size_t n = d ? msg->sysex_size : 0;
+    if (n && d[0] == 0xF0)     { d++; n--; }
+    if (n && d[n - 1] == 0xF7) n--;
+    *len = n;
+    return d;
+}
+
+/* Words msg needs as UMP; 0 = no UMP form. */
+static size_t mm__ump_size(const mm_message* msg, mm_ump_protocol proto) {
+    if (msg->type == MM_SYSEX) {
+        size_t len;
+        mm__ump_sysex_body(msg, &len);
+        return len ? 2 * ((len + 5) / 6) : 2;
+    }
+    if ((unsigned)msg->type >= 32 || !mm__type_table[msg->type].status) return 0;
+    return (proto == MM_UMP_PROTOCOL_MIDI2 && msg->type <= MM_PITCH_BEND) ? 2 : 1;
+}
+
+size_t mm_ump_from_message(const mm_message* msg, mm_ump_protocol proto,
+                           uint32_t* out, size_t cap)
+{
+    const uint32_t group = msg->port_index & 0x0F;
+    const size_t need = mm__ump_size(msg, proto);
+    if (need == 0 || need > cap) return 0;
+    if (msg->type != MM_SYSEX) return mm__ump_short(msg, proto, group, out);
+
+    size_t len;
+    const uint8_t* d = mm__ump_sysex_body(msg, &len);
+    const size_t packets = need / 2;
+    for (size_t k = 0; k < packets; k++) {
+        unsigned chunk = (unsigned)(len - 6 * k < 6 ? len - 6 * k : 6);
+        uint32_t status = packets == 1 ? MM_UMP_SYSEX_COMPLETE
+                        : k == 0       ? MM_UMP_SYSEX_START
+                        : k + 1 == packets ? MM_UMP_SYSEX_END : MM_UMP_SYSEX_CONTINUE;
+        mm__ump_sysex_packet(group, status, d + 6 * k, chunk, out + 2 * k);
+    }
+    return 2 * packets;
+}
+
+size_t mm_ump_from_messages(const mm_message* msgs, size_t n, mm_ump_protocol proto,
+                            uint32_t* out, size_t cap, size_t* written)
+{
+    size_t i = 0, w = 0;
+    for (; i < n; i++) {
+        size_t need = mm__ump_size(&msgs[i], proto);
+        if (need > cap - w) break;
+        if (need) w += mm_ump_from_message(&msgs[i], proto, out + w, cap - w);
+    }
+    if (written) *written = w;
+    return i;
+}
+
+/* Encoder output: words go to out[] until it is full, then are counted
+   as dropped.                                                             */
+typedef struct mm__ump_sink {
+    mm_ump_encoder* e;
+    uint32_t*       out;
+    size_t          cap, len;
+    int             dropped;
+} mm__ump_sink;
+
+static void mm__ump_sink_put(mm__ump_sink* s, const uint32_t* w, size_t n) {
+    if (n > s->cap - s->len) { s->dropped = 1; return; }
+    memcpy(s->out + s->len, w, n * sizeof(uint32_t));
+    s->len += n;
+}
+
+static void mm__ump_sink_emit(const mm_message* msg, void* ud) {
+    mm__ump_sink* s = (mm__ump_sink*)ud;
+    uint32_t w[2];
+    size_t n = mm__ump_short(msg, s->e->protocol, s->e->group, w);
+    if (n) mm__ump_sink_put(s, w, n);
+}
+
+/* Flush the packet being filled; last = the SysEx ends with it. */
+static void mm__ump_sysex_flush(mm__ump_sink* s, int last) {
+    mm_ump_encoder* e = s->e;
+    uint32_t status = e->sysex_state == 1 ? (last ? MM_UMP_SYSEX_COMPLETE : MM_UMP_SYSEX_START)
+                                          : (last ? MM_UMP_SYSEX_END      : MM_UMP_SYSEX_CONTINUE);
+    uint32_t w[2];
+    mm__ump_sysex_packet(e->group, status, e->sysex, e->sysex_len, w);
+    mm__ump_sink_put(s, w, 2);
+    e->sysex_len   = 0;
+    e->sysex_state = last ? 0 : 2;
+}
+
+/* A full packet is held back until the next byte shows whether it is the
+   last one.                                                               */
+static void mm__ump_sysex_put(mm__ump_sink* s, const uint8_t* d, size_t n) {
+    mm_ump_encoder* e = s->e;
+    while (n) {
+        if (e->sysex_len == 6) mm__ump_sysex_flush(s, 0);
+        size_t take = 6u - e->sysex_len;
+        if (take > n) take = n;
+        memcpy(e->sysex + e->sysex_len, d, take);
+        e->sysex_len = (uint8_t)(e->sysex_len + take);
+        d += take; n -= take;
+    }
+}
+
+void mm_ump_encoder_init(mm_ump_encoder* e, mm_ump_protocol proto, uint8_t group) {
+    memset(e, 0, sizeof(*e));
+    mm_parser_init(&e->parser, NULL, 0);
+    e->protocol = proto;
+    e->group    = group & 0x0F;
+}
+
+mm_result mm_ump_encoder_feed(mm_ump_encoder* e, const uint8_t* bytes, size_t n,
+                              uint32_t* out, size_t cap, size_t* written)
+{
+    mm__ump_sink s = { e, out, cap, 0, 0 };
+    size_t i = 0;
+    while (i < n) {
+        if (e->sysex_state) {
+            size_t end = i + mm_scan_status(bytes + i, n - i);
+            mm__ump_sysex_put(&s, bytes + i, end - i);
+            i = end;
+            if (i == n) break;
+            uint8_t b = bytes[i];
+            if (b >= 0xF8) {   /* real-time may sit between SysEx packets */
+                uint32_t w = 0x10000000u | (uint32_t)e->group << 24 | (uint32_t)b << 16;
+                if (mm__status_table[b].type) mm__ump_sink_put(&s, &w, 1);
+                i++;
+                continue;
+            }
+            mm__ump_sysex_flush(&s, 1);   /* F7, or cut short by a status */
+            if (b == 0xF7) { i++; continue; }
+        }
+        /* Everything up to the next F0 is short messages. */
+        const uint8_t* f0 = (const uint8_t*)memchr(bytes + i, 0xF0, n - i);
+        size_t end = f0 ? (size_t)(f0 - bytes) : n;
+        mm_parser_feed(&e->parser, bytes + i, end - i, mm__ump_sink_emit, &s);
+        i = end;
+        if (i < n) {
+            mm_parser_reset(&e->parser);   /* SysEx cancels running status */
+            e->sysex_state = 1; e->sysex_len = 0;
+            i++;
+        }
+    }
+    if (written) *written = s.len;
+    return s.dropped ? MM_OUT_OF_RANGE : MM_SUCCESS;
+}
+
+void mm_ump_decoder_init(mm_ump_decoder* d, uint8_t* sysex_buf, size_t sysex_cap) {
+    memset(d, 0, sizeof(*d));
+    d->sysex     = sysex_buf;
+    d->sysex_cap = sysex_cap;
+}
+
+static void mm__ump_emit(mm_ump_decoder* d, mm_message* m, uint32_t group,
+                         mm_parser_emit emit, void* ud)
+{
+    m->timestamp  = d->timestamp;
+    m->port_index = (uint16_t)group;
+    emit(m, ud);
+}
+
+static void mm__ump_emit_cc(mm_ump_decoder* d, uint32_t group, uint8_t ch,
+                            uint8_t cc, uint8_t v, mm_parser_emit emit, void* ud)
+{
+    mm_message m = mm__decode((uint8_t)(0xB0 | ch), cc, v);
+    mm__ump_emit(d, &m, group, emit, ud);
+}
+
+static void mm__ump_sysex_append(mm_ump_decoder* d, const uint8_t* b, size_t n) {
+    if (d->in_sysex != 1) return;
+    if (!d->sysex || n > d->sysex_cap - d->sysex_len) { d->in_sysex = 2; return; }
+    memcpy(d->sysex + d->sysex_len, b, n);
+    d->sysex_len += n;
+}
+
+static void mm__ump_decode_sysex7(mm_ump_decoder* d, const uint32_t* w,
+                                  mm_parser_emit emit, void* ud)
+{
+    const uint32_t group  = MM_UMP_GROUP(w[0]);
+    const uint32_t status = (w[0] >> 20) & 0x0F;
+    uint32_t n = (w[0] >> 16) & 0x0F;
+    if (n > 6) n = 6;
+    uint8_t b[8];
+    b[0] = 0xF0;
+    b[1] = (uint8_t)(w[0] >> 8);  b[2] = (uint8_t)w[0];
+    b[3] = (uint8_t)(w[1] >> 24); b[4] = (uint8_t)(w[1] >> 16);
+    b[5] = (uint8_t)(w[1] >> 8);  b[6] = (uint8_t)w[1];
+    for (uint32_t k = 1; k <= n; k++) b[k] &= 0x7F;
+
+    mm_message m;
+    memset(&m, 0, sizeof(m));
+    m.type = MM_SYSEX;
+    m.source_client = m.source_port = -1;
+
+    if (status == MM_UMP_SYSEX_COMPLETE) {
+        b[n + 1] = 0xF7;
+        m.sysex = b; m.sysex_size = n + 2;
+        mm__ump_emit(d, &m, group, emit, ud);
+        return;
+    }
+    if (status == MM_UMP_SYSEX_START) {
+        d->in_sysex = 1; d->sysex_len = 0; d->sysex_group = (uint8_t)group;
+        mm__ump_sysex_append(d, b, n + 1);
+        return;
+    }
+    if (!d->in_sysex || group != d->sysex_group) return;
+    mm__ump_sysex_append(d, b + 1, n);
+    if (status == MM_UMP_SYSEX_END) {
+        uint8_t f7 = 0xF7;
+        mm__ump_sysex_append(d, &f7, 1);
+        if (d->in_sysex == 1) {
+            m.sysex = d->sysex; m.sysex_size = d->sysex_len;
+            mm__ump_emit(d, &m, group, emit, ud);
+        }
+        d->in_sysex = 0; d->sysex_len = 0;
+    }
+}
+
+static void mm__ump_decode_midi2(mm_ump_decoder* d, const uint32_t* w,
+                                 mm_parser_emit emit, void* ud)
+{
+    const uint32_t group = MM_UMP_GROUP(w[0]);
+    const uint8_t  op    = (uint8_t)((w[0] >> 20) & 0x0F);
+    const uint8_t  ch    = (uint8_t)((w[0] >> 16) & 0x0F);
+    const uint8_t  i1    = (uint8_t)((w[0] >> 8) & 0x7F);
+    const uint8_t  i2    = (uint8_t)(w[0] & 0x7F);
+    uint8_t d1 = 0, d2 = 0;
+
+    switch (op) {
+    case 0x8: d1 = i1; d2 = (uint8_t)mm_ump_scale_down(w[1] >> 16, 16, 7); break;
+    case 0x9:
+        d1 = i1; d2 = (uint8_t)mm_ump_scale_down(w[1] >> 16, 16, 7);
+        if (d2 == 0) d2 = 1;   /* 0 would turn it into a note-off */
+        break;
+    case 0xA:
+    case 0xB: d1 = i1; d2 = (uint8_t)mm_ump_scale_down(w[1], 32, 7);       break;
+    case 0xC:
+        if (w[0] & 1) {   /* bank valid */
+            mm__ump_emit_cc(d, group, ch, 0,  (uint8_t)((w[1] >> 8) & 0x7F), emit, ud);
+            mm__ump_emit_cc(d, group, ch, 32, (uint8_t)(w[1] & 0x7F),        emit, ud);
+        }
+        d1 = (uint8_t)((w[1] >> 24) & 0x7F);
+        break;
+    case 0xD: d1 = (uint8_t)mm_ump_scale_down(w[1], 32, 7);                break;
+    case 0xE: {
+        uint32_t v = mm_ump_scale_down(w[1], 32, 14);
+        d1 = (uint8_t)(v & 0x7F); d2 = (uint8_t)(v >> 7);
+        break;
+    }
+    case 0x2:   /* registered controller → RPN */
+    case 0x3: { /* assignable controller → NRPN */
+        uint32_t v = mm_ump_scale_down(w[1], 32, 14);
+        mm__ump_emit_cc(d, group, ch, op == 0x2 ? 101 : 99, i1, emit, ud);
+        mm__ump_emit_cc(d, group, ch, op == 0x2 ? 100 : 98, i2, emit, ud);
+        mm__ump_emit_cc(d, group, ch, 6,  (uint8_t)(v >> 7),   emit, ud);
+        mm__ump_emit_cc(d, group, ch, 38, (uint8_t)(v & 0x7F), emit, ud);
+        return;
+    }
+    default: return;   /* per-note and relative controllers, note management */
+    }
+    mm_message m = mm__decode((uint8_t)(op << 4 | ch), d1, d2);
+    mm__ump_emit(d, &m, group, emit, ud);
+}
+
+size_t mm_ump_decode(mm_ump_decoder* d, const uint32_t* words, size_t n,
+                     mm_parser_emit emit, void* userdata)
+{
+    size_t i = 0;
+    while (i < n) {
+        const uint32_t w0 = words[i];
+        const uint32_t len = mm_ump_words(w0);
+        if (len > n - i) break;
+        switch (MM_UMP_TYPE(w0)) {
+        case MM_UMP_SYSTEM:
+        case MM_UMP_MIDI1_VOICE: {
+            uint8_t st = (uint8_t)(w0 >> 16);
+            const mm__status_info si = mm__status_table[st];
+            /* MT 0x1 carries system statuses only, MT 0x2 channel ones. */
+            if (!si.type || (si.flags & MM__ST_SYSEX)) break;
+            if (((si.flags & MM__ST_CHANNEL) != 0) != (MM_UMP_TYPE(w0) == MM_UMP_MIDI1_VOICE)) break;
+            mm_message m = mm__decode(st, (uint8_t)((w0 >> 8) & 0x7F), (uint8_t)(w0 & 0x7F));
+            mm__ump_emit(d, &m, MM_UMP_GROUP(w0), emit, userdata);
+            break;
+        }
+        case MM_UMP_SYSEX7:      mm__ump_decode_sysex7(d, words + i, emit, userdata); break;
+        case MM_UMP_MIDI2_VOICE: mm__ump_decode_midi2 (d, words + i, emit, userdata); break;
+        default: break;   /* no MIDI 1.0 form */
+        }
+        i += len;
+    }
+    return i;
+}
+
+/* ── Clock tracking ────────────────────────────────────────────────────────
+   Loop after F. Adriaensen, "Using a DLL to filter time" (2005): with
+   w = 2π·B·period, b = √2·w and c = w² give a critically damped loop of
+   bandwidth B Hz. e is a clock's distance from its prediction.            */
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static void mm__fence(void) { volatile long f = 0; _InterlockedExchange(&f, 0); }
+#  define mm__fence_acquire() mm__fence()
+#  define mm__fence_release() mm__fence()
+#else
+#  define mm__fence_acquire() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#  define mm__fence_release() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#define MM__CLOCK_MIN_PERIOD (60.0 / (24.0 * 1000.0))   /* 1000 BPM */
+#define MM__CLOCK_MAX_PERIOD (60.0 / (24.0 * 10.0))     /*   10 BPM */
+#define MM__CLOCK_SETTLE     24                         /* one beat, 4x wide */
+
+void mm_clock_tracker_init(mm_clock_tracker* t) {
+    memset(t, 0, sizeof(*t));
+    t->bandwidth       = 0.5;
+    t->dropout_periods = 12.0;
+}
+
+/* Writer side of the seqlock: odd while info is being changed. The fence
+   keeps the writes that follow from moving above the odd store.           */
+static void mm__seq_begin(uint32_t* seq) {
+    mm__store_release(seq, *seq + 1);
+    mm__fence_release();
+}
+static void mm__seq_end(uint32_t* seq) {
+    mm__store_release(seq, *seq + 1);
+}
+
+static void mm__clock_lock(mm_clock_tracker* t, double ts, double period) {
+    mm_clock_info* in = &t->info;
+    in->locked    = 1;
+    in->period    = period;
+    in->last_tick = ts;
+    in->next_tick = ts + period;
+    t->settle = 0; t->streak = 0;
+}
+
+static void mm__clock_tick(mm_clock_tracker* t, double ts) {
+    mm_clock_info* in = &t->info;
+    uint32_t n = 1;   /* clocks since the last one, lost ones included */
+    in->clocks++;
+
+    const double prev = t->prev;
+    t->prev = ts;
+    if (!in->locked) {
+        double d = ts - prev;
+        if (prev > 0.0 && d >= MM__CLOCK_MIN_PERIOD && d <= MM__CLOCK_MAX_PERIOD)
+            mm__clock_lock(t, ts, d);
+    } else {
+        /* Lost clocks are counted from the raw gap, which the loop's lag
+           behind a tempo change doesn't skew.                             */
+        const double p = in->period;
+        double k = (ts - prev) / p + 0.5;
+        /* Fresh from a lock the period is one raw interval: demand a
+           clear gap before calling a clock lost.                          */
+        if (k < 1.0 || (t->settle < MM__CLOCK_SETTLE / 4 && k < 2.5)) k = 1.0;
+        if (k > t->dropout_periods) {
+            /* Silence: the phase is gone, the tempo probably isn't. */
+            in->dropouts++;
+            mm__clock_lock(t, ts, p);
+        } else {
+            n = (uint32_t)k;
+            in->lost += n - 1;
+            const double pred = in->last_tick + n * p;
+            double e = ts - pred;
+            t->jitter += ((e < 0 ? -e : e) - t->jitter) * (1.0 / 16.0);
+
+            /* Past the settling beat, clamp errors far outside the jitter
+               seen so far; a run of them in one direction is a tempo
+               change, so settle again.                                    */
+            if (t->settle >= MM__CLOCK_SETTLE) {
+                const double gate = 5.0 * t->jitter + 0.01 * p;
+                if (e > gate || e < -gate) {
+                    t->streak = (e > 0) == (t->streak > 0) ? t->streak + (e > 0 ? 1 : -1)
+                                                           : (e > 0 ? 1 : -1);
+                    e = e > 0 ? gate : -gate;
+                    if (t->streak >= 4 || t->streak <= -4) t->settle = 0;
+                } else {
+                    t->streak = 0;
+                }
+            }
+
+            double bw = t->bandwidth;
+            if (t->settle < MM__CLOCK_SETTLE) bw *= 4.0;
+            const double w = 2.0 * 3.14159265358979323846 * bw * p;
+            double np = p + w * w * e / n;
+            if (np < MM__CLOCK_MIN_PERIOD) np = MM__CLOCK_MIN_PERIOD;
+            if (np > MM__CLOCK_MAX_PERIOD) np = MM__CLOCK_MAX_PERIOD;
+            in->last_tick = pred + 1.41421356237309505 * w * e;
+            in->period    = np;
+            in->next_tick = in->last_tick + np;
+            if (t->settle < MM__CLOCK_SETTLE) t->settle++;
+        }
+    }
+
+    if (in->running) {
+        if (!t->waiting) t->song_clock += n;   /* else this clock is song_clock */
+        t->waiting = 0;
+    }
+}
+
+/* Derived fields, recomputed after every change. */
+static void mm__clock_publish(mm_clock_tracker* t) {
+    mm_clock_info* in = &t->info;
+    in->bpm    = in->locked ? 60.0 / (24.0 * in->period) : 0.0;
+    in->jitter = t->jitter;
+    double q = 0.0;
+    if (in->locked) {
+        double r = in->jitter / (0.1 * in->period);
+        q = (double)t->settle / MM__CLOCK_SETTLE / (1.0 + r * r);
+    }
+    in->confidence = q;
+    in->position   = t->song_clock / 24.0;
+    in->phase      = in->position - (double)(t->song_clock / 24u);
+}
+
+void mm_clock_tracker_push(mm_clock_tracker* t, const mm_message* msg) {
+    if (!t || !msg) return;
+    switch (msg->type) {
+    case MM_CLOCK: case MM_START: case MM_CONTINUE: case MM_STOP:
+    case MM_SONG_POSITION: case MM_RESET: break;
+    default: return;
+    }
+    mm__seq_begin(&t->seq);
+    mm_clock_info* in = &t->info;
+    switch (msg->type) {
+    case MM_CLOCK:
+        mm__clock_tick(t, msg->timestamp);
+        break;
+    case MM_START:
+        /* The next clock is the downbeat of song position 0. */
+        in->running = 1; t->song_clock = 0; t->waiting = 1;
+        break;
+    case MM_CONTINUE:
+        /* Resume one clock after the last one played, or where SPP said. */
+        if (!t->waiting) t->song_clock++;
+        in->running = 1; t->waiting = 1;
+        break;
+    case MM_STOP:
+        in->running = 0;
+        break;
+    case MM_SONG_POSITION:
+        /* Normally sent while stopped: the next clock played lands here. */
+        t->song_clock = (uint32_t)msg->song_position * 6u; t->waiting = 1;
+        break;
+    default:     /* MM_RESET: back to init state; settings and seq stay */
+        t->prev = 0.0; t->jitter = 0.0;
+        t->song_clock = 0; t->settle = 0; t->streak = 0; t->waiting = 0;
+        memset(in, 0, sizeof(*in));
+        break;
+    }
+    mm__clock_publish(t);
+    mm__seq_end(&t->seq);
+}
+
+void mm_clock_tracker_read(const mm_clock_tracker* t, double now, mm_clock_info* out) {
+    if (!t || !out) return;
+    int waiting;
+    for (;;) {
+        const uint32_t s0 = mm__load_acquire(&t->seq);
+        if (s0 & 1) continue;
+        memcpy(out, &t->info, sizeof(*out));
+        waiting = t->waiting;
+        mm__fence_acquire();
+        if (mm__load_acquire(&t->seq) == s0) break;
+    }
+    out->dropout = 0;
+    if (now <= 0.0 || !out->locked) return;
+    double since = (now - out->last_tick) / out->period;
+    if (since > t->dropout_periods) { out->dropout = 1; out->confidence = 0.0; }
+    if (!out->running || waiting || since <= 0.0) return;
+    /* Between clocks: interpolate, but never run ahead of the master. */
+    if (since > 1.0) since = 1.0;
+    out->position += since / 24.0;
+    out->phase    += since / 24.0;
+    if (out->phase >= 1.0) out->phase -= 1.0;
+}
+
+/* ── MTC generation ───────────────────────────────────────────────────── */
+
+static double mm__mtc_quarter(mm_mtc_rate r) { return 0.25 / mm_mtc_frame_rate(r); }
+
+void mm_mtc_generator_locate(mm_mtc_generator* g, const mm_mtc_frame* f,
+                             double time, uint8_t sysex[MM_MTC_FULL_FRAME_SIZE]) {
+    if (!g || !f) return;
+    g->rate    = (mm_mtc_rate)(f->rate & 3);
+    g->located = 1;
+    g->origin  = time;
+    g->start   = mm_mtc_to_frames(f);
+    g->quarter = 0;
+    if (sysex) {
+        mm_mtc_frame ff;
+        mm_mtc_from_frames(g->start, g->rate, &ff);   /* normalised */
+        mm_mtc_full_frame(&ff, sysex);
+    }
+}
+
+size_t mm_mtc_generator_render(mm_mtc_generator* g, double until,
+                               mm_message* out, size_t cap) {
+    if (!g || !out || !g->located) return 0;
+    const double qp = mm__mtc_quarter(g->rate);
+    mm_mtc_frame f;
+    size_t n = 0;
+    while (n < cap) {
+        const double t = g->origin + (double)g->quarter * qp;
+        if (t >= until) break;
+        const uint32_t piece = g->quarter & 7u;
+        mm_mtc_from_frames(g->start + (g->quarter >> 3) * 2u, g->rate, &f);
+        uint8_t v;
+        switch (piece) {
+        case 0:  v = f.frames  & 0x0F;       break;
+        case 1:  v = f.frames  >> 4;         break;
+        case 2:  v = f.seconds & 0x0F;       break;
+        case 3:  v = f.seconds >> 4;         break;
+        case 4:  v = f.minutes & 0x0F;       break;
+        case 5:  v = f.minutes >> 4;         break;
+        case 6:  v = f.hours   & 0x0F;       break;
+        default: v = (uint8_t)((f.hours >> 4) | (g->rate << 1)); break;
+        }
+        out[n] = mm_make_message(0xF1, (uint8_t)((piece << 4) | v), 0);
+        out[n].timestamp = t;
+        n++;
+        g->quarter++;
+    }
+    return n;
+}
+
+void mm_mtc_generator_position(const mm_mtc_generator* g, double time,
+                               mm_mtc_frame* out) {
+    if (!g || !out) return;
+    double q = g->located ? (time - g->origin) / mm__mtc_quarter(g->rate) : 0.0;
+    if (q < 0.0) q = 0.0;
+    mm_mtc_from_frames(g->start + (uint32_t)(q / 4.0), g->rate, out);
+}
+
+/* ── MTC chase ──────────────────────────────────────────────────────────── */
+
+static double mm__mtc_wrap(double pos, mm_mtc_rate r) {
+    const double n = (double)mm_mtc_frames_per_day(r);
+    while (pos <  0.0) pos += n;
+    while (pos >= n)   pos -= n;
+    return pos;
+}
+
+static void mm__mtc_set_position(mm_mtc_chase_info* in, double pos) {
+    const mm_mtc_rate r = in->frame.rate;
+    in->position = mm__mtc_wrap(pos, r);
+    in->seconds  = in->position / mm_mtc_frame_rate(r);
+    mm_mtc_from_frames((uint32_t)in->position, r, &in->frame);
+}
+
+void mm_mtc_chaser_init(mm_mtc_chaser* c) {
+    memset(c, 0, sizeof(*c));
+    c->dropout_frames = 4.0;
+    c->last = -1;
+    c->run  = -1;
+}
+
+/* Lose the position; it holds until a whole cycle or a locate. */
+static void mm__mtc_unlock(mm_mtc_chaser* c) {
+    c->tracking = 0; c->run = -1; c->dir = 0;
+    c->info.locked = 0; c->info.direction = 0; c->info.speed = 0.0;
+}
+
+static void mm__mtc_quarter_in(mm_mtc_chaser* c, uint8_t qf, double ts) {
+    mm_mtc_chase_info* in = &c->info;
+    const int p = (qf >> 4) & 7;
+    const uint32_t days = mm_mtc_frames_per_day(in->frame.rate);
+    const double nominal = mm__mtc_quarter(in->frame.rate);
+    in->quarters++;
+
+    if (c->prev > 0.0 && ts - c->prev > c->dropout_frames * 4.0 * nominal) {
+        in->dropouts++;
+        mm__mtc_unlock(c);
+        c->last = -1;
+    }
+    int d = 0;
+    if (c->last >= 0) {
+        d = ((p - c->last) & 7) == 1 ? 1 : ((c->last - p) & 7) == 1 ? -1 : 0;
+        if (!d) {   /* skipped or repeated piece */
+            in->errors++;
+            mm__mtc_unlock(c);
+            c->last = p; c->prev = ts;
+            return;
+        }
+    }
+
+    /* Cycle bookkeeping: forward wraps 7 → 0, reverse 0 → 7. */
+    if (d && d != c->dir) {
+        /* A reversal, or the first step contradicting the presumed start. */
+        if (c->dir || (c->last == 0) != (d > 0)) c->run = -1;
+        c->period = nominal; in->anchor = ts;
+    }
+    else if (d) {
+        const double e = ts - (in->anchor + c->period);
+        if (e > -c->period && e < c->period) {
+            in->anchor += c->period + 0.25 * e;
+            c->period  += 0.02 * e;
+            if (c->period < 0.5 * nominal) c->period = 0.5 * nominal;
+            if (c->period > 2.0 * nominal) c->period = 2.0 * nominal;
+        } else { in->anchor = ts; c->period = nominal; }
+    } else { in->anchor = ts; c->period = nominal; }
+    if (c->tracking) {
+        if (d > 0 && p == 0) c->base = (c->base + 2u) % days;
+        if (d < 0 && p == 7) c->base = (c->base + days - 2u) % days;
+    }
+    c->dir = d;
+    c->last = p; c->prev = ts;
+
+    /* Collect: a cycle starts on piece 0 (forward) or 7 (reverse). */
+    if ((d >= 0 && p == 0) || (d <= 0 && p == 7)) c->run = 0;
+    if (c->run >= 0) {
+        c->pieces[p] = (uint8_t)(qf & 0x0F);
+        if (++c->run == 8) {
+            mm_mtc_frame f;
+            f.frames  = (uint8_t)(c->pieces[0] | (c->pieces[1] << 4));
+            f.seconds = (uint8_t)(c->pieces[2] | (c->pieces[3] << 4));
+            f.minutes = (uint8_t)(c->pieces[4] | (c->pieces[5] << 4));
+            f.hours   = (uint8_t)(c->pieces[6] | ((c->pieces[7] & 1) << 4));
+            f.rate    = (mm_mtc_rate)((c->pieces[7] >> 1) & 3);
+            in->frame.rate = f.rate;
+            c->base = mm_mtc_to_frames(&f);
+            c->tracking = 1;
+            c->run = -1;
+        }
+    }
+
+    in->locked    = c->tracking;
+    in->direction = c->dir;
+    in->speed     = c->dir * mm__mtc_quarter(in->frame.rate) / c->period;
+    if (c->tracking) mm__mtc_set_position(in, (double)c->base + p * 0.25);
+}
+
+static int mm__mtc_full_frame_in(mm_mtc_chaser* c, const uint8_t* b, size_t n, double ts) {
+    if (n != MM_MTC_FULL_FRAME_SIZE || b[0] != 0xF0 || b[1] != 0x7F ||
+        b[3] != 0x01 || b[4] != 0x01 || b[9] != 0xF7) return 0;
+    mm_mtc_chase_info* in = &c->info;
+    mm_mtc_frame f;
+    f.hours   = (uint8_t)(b[5] & 0x1F);
+    f.minutes = (uint8_t)(b[6] & 0x3F);
+    f.seconds = (uint8_t)(b[7] & 0x3F);
+    f.frames  = (uint8_t)(b[8] & 0x1F);
+    f.rate    = (mm_mtc_rate)((b[5] >> 5) & 3);
+    mm__mtc_unlock(c);
+    in->frame.rate = f.rate;
+    in->locates++;
+    in->anchor = ts;
+    c->base = mm_mtc_to_frames(&f);
+    c->tracking = 1; in->locked = 1;
+    c->last = -1; c->prev = 0.0;   /* quarter frames resume from piece 0 */
+    mm__mtc_set_position(in, (double)c->base);
+    return 1;
+}
+
+void mm_mtc_chaser_push(mm_mtc_chaser* c, const mm_message* msg) {
+    if (!c || !msg) return;
+    switch (msg->type) {
+    case MM_MTC_QUARTER_FRAME:
+        mm__seq_begin(&c->seq);
+        mm__mtc_quarter_in(c, msg->data[0], msg->timestamp);
+        mm__seq_end(&c->seq);
+        break;
+    case MM_SYSEX:
+        if (msg->sysex_size != MM_MTC_FULL_FRAME_SIZE) return;
+        mm__seq_begin(&c->seq);
+        mm__mtc_full_frame_in(c, msg->sysex, msg->sysex_size, msg->timestamp);
+        mm__seq_end(&c->seq);
+        break;
+    case MM_RESET:
+        /* Back to init state; the setting and seq stay. */
+        mm__seq_begin(&c->seq);
+        memset(c->pieces, 0, sizeof(c->pieces));
+        c->last = -1; c->run = -1; c->dir = 0; c->tracking = 0;
+        c->base = 0; c->prev = 0.0; c->period = 0.0;
+        memset(&c->info, 0, sizeof(c->info));
+        mm__seq_end(&c->seq);
+        break;
+    default: break;
+    }
+}
+
+void mm_mtc_chaser_read(const mm_mtc_chaser* c, double now, mm_mtc_chase_info* out) {
+    if (!c || !out) return;
+    for (;;) {
+        const uint32_t s0 = mm__load_acquire(&c->seq);
+        if (s0 & 1) continue;
+        memcpy(out, &c->info, sizeof(*out));
+        mm__fence_acquire();
+        if (mm__load_acquire(&c->seq) == s0) break;
+    }
+    out->dropout = 0;
+    if (now <= 0.0 || !out->locked) return;
+    const double fps = mm_mtc_frame_rate(out->frame.rate);
+    const double since = now - out->anchor;
+    if (out->direction && since > c->dropout_frames / fps) {
+        out->dropout = 1; out->speed = 0.0;
+        return;
+    }
+    if (!out->direction || since <= 0.0) return;
+    /* Between quarter frames: interpolate, never past the next one. */
+    double adv = since * fps * out->speed;
+    if (adv >  0.25) adv =  0.25;
+    if (adv < -0.25) adv = -0.25;
+    mm__mtc_set_position(out, out->position + adv);
+}
+
+/* Minimal glob: '*' matches any run, '?' any single character. */
+static int mm__glob_match(const char* pat, const char* str) {
+    const char* star = NULL; const char* retry = NULL;
+    while (*str) {
+        if (*pat == '*')                      { star = pat++; retry = str; }
+        else if (*pat == '?' || *pat == *str) { pat++; str++; }
+        else if (star)                        { pat = star + 1; str = ++retry; }
+        else return 0;
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+/* UMP I/O state a device may carry; freed on close. Shared code is after
+   the backends.                                                           */
+static void mm__ump_release(mm_device* dev);
+
+/* Backends fill a registry through these; shared code is after the backends. */
+static mm_result mm__registry_add(mm_port_registry* reg, const char* name,
+                                  int client, int port, uint32_t flags,
+                                  uint32_t caps, uint32_t type);
+static mm_result mm__registry_enum(mm_port_registry* reg);
+static mm_result mm__registry_index(mm_port_registry* reg);
+static mm_result mm__registry_insert(mm_port_registry* reg, uint32_t pos,
+                                     const char* name, int client, int port,
+                                     uint32_t flags, uint32_t caps, uint32_t type);
+static void      mm__registry_remove(mm_port_registry* reg, uint32_t pos);
+static mm_result mm__registry_intern(mm_port_registry* reg, const char* str,
+                                     const char** out);
+static int       mm__registry_find(const mm_port_registry* reg, int client,
+                                   int port, uint32_t* pos);
+
+/* ─────────────────────────────────────────────────────────────────────────────
+   CoreMIDI (macOS / iOS)
+   ───────────────────────────────────────────────────────────────────────── */
+#if defined(MM_BACKEND_COREMIDI)
+
+#include <mach/mach_time.h>
+
+static const mach_timebase_info_data_t* mm__cm_timebase(void) {
+    static mach_timebase_info_data_t tb; static int init=0;
+    if (!init) { mach_timebase_info(&tb); init=1; }
+    return &tb;
+}
+static double mm__cm_ts(MIDITimeStamp ts) {
+    const mach_timebase_info_data_t* tb = mm__cm_timebase();
+    return (double)ts * tb->numer / tb->denom * 1e-9;
+}
+static MIDITimeStamp mm__cm_host(double seconds) {
+    const mach_timebase_info_data_t* tb = mm__cm_timebase();
+    return (MIDITimeStamp)(seconds * 1e9 * tb->denom / tb->numer);
+}
+
+static void mm__cm_emit(const mm_message* msg, void* ud) {
+    mm_device* dev = (mm_device*)ud;
+    dev->callback(dev, msg, dev->userdata);
+}
+
+/* A parser's SysEx buffer, made on the caller's thread: at mm_in_start,
+   or at open for virtual inputs, which receive from then on.              */
+static mm_result mm__cm_parser_prepare(mm_context* ctx, mm_parser* ps) {
+    if (ps->sysex || ctx->config.lazy_sysex) return MM_SUCCESS;
+    ps->sysex = (uint8_t*)mm__malloc(ctx, ctx->config.sysex_size);
+    if (!ps->sysex) return MM_ALLOC_FAILED;
+    ps->sysex_cap = ctx->config.sysex_size;
+    return MM_SUCCESS;
+}
+
+/* CoreMIDI may split one message — SysEx especially — across packets and
+   packet lists, so each endpoint keeps a parser between calls. With
+   lazy_sysex its SysEx buffer is allocated the first time an F0 shows up. */
+static void mm__cm_parse(mm_device* dev, mm_parser* ps, const MIDIPacketList* pl)
+{
+    if (!dev || !dev->callback) return;
+
+    const MIDIPacket* pkt = &pl->packet[0];
+    for (UInt32 i = 0; i < pl->numPackets; i++) {
+        if (!ps->sysex && dev->ctx->config.lazy_sysex &&
+            memchr(pkt->data, 0xF0, pkt->length)) {
+            size_t cap = dev->ctx->config.sysex_size;
+            uint8_t* buf = (uint8_t*)mm__malloc(dev->ctx, cap);
+            if (buf) { ps->sysex = buf; ps->sysex_cap = cap; }
+        }
+        ps->timestamp = mm__cm_ts(pkt->timeStamp);
+        mm_parser_feed(ps, pkt->data, pkt->length, mm__cm_emit, dev);
+        pkt = MIDIPacketNext(pkt);
+    }
+}
+
+static void mm__cm_read_proc(const MIDIPacketList* pl, void* ref, void* src)
+{
+    mm_device* dev = (mm_device*)ref; (void)src;
+    mm__cm_parse(dev, &dev->cm.parser, pl);
+}
+
+static void mm__cm_vport_read_proc(const MIDIPacketList* pl, void* ref, void* src)
+{
+    mm__cm_vport* vp = (mm__cm_vport*)ref; (void)src;
+    mm__cm_parse(vp->dev, &vp->parser, pl);
+}
+
+mm_result mm_context_init_ex(mm_context* ctx, const mm_context_config* config) {
+    if (!ctx) return MM_INVALID_ARG;
+    mm_result res = mm__context_setup(ctx, config);
+    if (res != MM_SUCCESS) return res;
+    /* CoreMIDI owns its receive thread; there is nothing to poll. */
+    if (ctx->config.delivery == MM_DELIVERY_POLL) return MM_NO_BACKEND;
+    CFStringRef cfname = CFStringCreateWithCString(NULL, ctx->name, kCFStringEncodingUTF8);
+    OSStatus st = MIDIClientCreate(cfname, NULL, NULL, &ctx->cm.client);
+    CFRelease(cfname);
+    if (st != noErr) return MM_ERROR;
+    ctx->initialized = 1; return MM_SUCCESS;
+}
+mm_result mm_context_uninit(mm_context* ctx) {
+    if (!ctx || !ctx->initialized) return MM_INVALID_ARG;
+    for (uint32_t i = 0; i < ctx->cm.route_count; i++)
+        MIDIThruConnectionDispose(ctx->cm.routes[i].thru);
+    ctx->cm.route_count = 0;
+    mm__free(ctx, ctx->cm.routes); ctx->cm.routes = NULL; ctx->cm.route_cap = 0;
+    MIDIClientDispose(ctx->cm.client); ctx->initialized = 0; return MM_SUCCESS;
+}
+mm_result mm_context_dispatch(mm_context* ctx, int timeout_ms, uint32_t* dispatched) {
+    (void)ctx; (void)timeout_ms;
+    if (dispatched) *dispatched = 0;
+    return MM_NO_BACKEND;
+}
+
+uint32_t mm_in_count (mm_context* ctx) { (void)ctx; return (uint32_t)MIDIGetNumberOfSources();      }
+uint32_t mm_out_count(mm_context* ctx) { (void)ctx; return (uint32_t)MIDIGetNumberOfDestinations();  }
+
+static mm_result mm__cm_name(MIDIEndpointRef ep, char* buf, size_t sz) {
+    CFStringRef n = NULL;
+    MIDIObjectGetStringProperty(ep, kMIDIPropertyDisplayName, &n);
+    if (!n) MIDIObjectGetStringProperty(ep, kMIDIPropertyName, &n);
+    if (!n) { snprintf(buf, sz, "(unknown)"); return MM_ERROR; }
+    CFStringGetCString(n, buf, (CFIndex)sz, kCFStringEncodingUTF8);
+    CFRelease(n); return MM_SUCCESS;
+}
+mm_result mm_in_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
+    (void)ctx;
+    if (idx >= MIDIGetNumberOfSources()) return MM_OUT_OF_RANGE;
+    return mm__cm_name(MIDIGetSource(idx), buf, sz);
+}
+mm_result mm_out_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
+    (void)ctx;
+    if (idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    return mm__cm_name(MIDIGetDestination(idx), buf, sz);
+}
+
+static mm_result mm__registry_enum(mm_port_registry* reg) {
+    char name[256];
+    ItemCount n = MIDIGetNumberOfSources();
+    for (ItemCount i = 0; i < n; i++) {
+        mm__cm_name(MIDIGetSource(i), name, sizeof(name));
+        if (mm__registry_add(reg, name, -1, (int)i, MM_PORT_INPUT, 0, 0) != MM_SUCCESS)
+            return MM_ALLOC_FAILED;
+    }
+    n = MIDIGetNumberOfDestinations();
+    for (ItemCount i = 0; i < n; i++) {
+        mm__cm_name(MIDIGetDestination(i), name, sizeof(name));
+        if (mm__registry_add(reg, name, -1, (int)i, MM_PORT_OUTPUT, 0, 0) != MM_SUCCESS)
+            return MM_ALLOC_FAILED;
+    }
+    return MM_SUCCESS;
+}
+
+mm_result mm_in_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port,
+                          mm_callback cb, void* ud) {
+    if (!port||!(port->flags & MM_PORT_INPUT)) return MM_INVALID_ARG;
+    return mm_in_open(ctx, dev, (uint32_t)port->port, cb, ud);
+}
+mm_result mm_out_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port) {
+    if (!port||!(port->flags & MM_PORT_OUTPUT)) return MM_INVALID_ARG;
+    return mm_out_open(ctx, dev, (uint32_t)port->port);
+}
+
+/* CoreMIDI has no address syntax: the spec is a glob over endpoint names. */
+mm_result mm_in_open_by_address(mm_context* ctx, mm_device* dev, const char* spec,
+                                mm_callback cb, void* ud) {
+    if (!ctx||!dev||!cb||!spec) return MM_INVALID_ARG;
+    char name[256];
+    ItemCount n = MIDIGetNumberOfSources();
+    for (ItemCount i = 0; i < n; i++) {
+        mm__cm_name(MIDIGetSource(i), name, sizeof(name));
+        if (mm__glob_match(spec, name)) return mm_in_open(ctx, dev, (uint32_t)i, cb, ud);
+    }
+    return MM_OUT_OF_RANGE;
+}
+mm_result mm_out_open_by_address(mm_context* ctx, mm_device* dev, const char* spec) {
+    if (!ctx||!dev||!spec) return MM_INVALID_ARG;
+    char name[256];
+    ItemCount n = MIDIGetNumberOfDestinations();
+    for (ItemCount i = 0; i < n; i++) {
+        mm__cm_name(MIDIGetDestination(i), name, sizeof(name));
+        if (mm__glob_match(spec, name)) return mm_out_open(ctx, dev, (uint32_t)i);
+    }
+    return MM_OUT_OF_RANGE;
+}
+
+/* Hotplug would need a MIDINotifyProc on the client; not wired up yet. */
+mm_result mm_registry_watch(mm_port_registry* reg, mm_port_callback cb, void* ud) {
+    (void)reg; (void)cb; (void)ud;
+    return MM_NO_BACKEND;
+}
+mm_result mm_registry_unwatch(mm_port_registry* reg) { (void)reg; return MM_NO_BACKEND; }
+void mm_registry_lock  (mm_port_registry* reg) { (void)reg; }
+void mm_registry_unlock(mm_port_registry* reg) { (void)reg; }
+
+mm_result mm_in_open(mm_context* ctx, mm_device* dev, uint32_t idx,
+                     mm_callback cb, void* ud)
+{
+    if (!ctx||!dev||!cb) return MM_INVALID_ARG;
+    if (idx >= MIDIGetNumberOfSources()) return MM_OUT_OF_RANGE;
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx=ctx; dev->callback=cb; dev->userdata=ud; dev->is_input=1;
+    dev->cm.endpoint = MIDIGetSource(idx);
+    char portname[80]; snprintf(portname, sizeof(portname), "%s-in", ctx->name);
+    CFStringRef cfport = CFStringCreateWithCString(NULL, portname, kCFStringEncodingUTF8);
+    OSStatus st = MIDIInputPortCreate(ctx->cm.client, cfport,
+                                      mm__cm_read_proc, dev, &dev->cm.port);
+    CFRelease(cfport);
+    if (st != noErr) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+mm_result mm_in_start(mm_device* dev) {
+    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
+    if (dev->is_virtual) return MM_SUCCESS; /* CoreMIDI: other apps connect to us */
+    if (mm__cm_parser_prepare(dev->ctx, &dev->cm.parser) != MM_SUCCESS) return MM_ALLOC_FAILED;
+    return (MIDIPortConnectSource(dev->cm.port, dev->cm.endpoint, NULL) == noErr)
+           ? MM_SUCCESS : MM_ERROR;
+}
+double mm_in_time(const mm_device* dev) {
+    (void)dev; return mm__cm_ts(mach_absolute_time());
+}
+mm_result mm_in_stop(mm_device* dev) {
+    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
+    if (dev->is_virtual) return MM_SUCCESS;
+    MIDIPortDisconnectSource(dev->cm.port, dev->cm.endpoint); return MM_SUCCESS;
+}
+mm_result mm_in_close(mm_device* dev) {
+    if (!dev||!dev->is_open) return MM_NOT_OPEN;
+    mm_in_stop(dev);
+    if (dev->cm.vports) {
+        for (uint32_t i = 0; i < dev->cm.vport_count; i++) {
+            MIDIEndpointDispose(dev->cm.vports[i].ep);
+            mm__free(dev->ctx, dev->cm.vports[i].parser.sysex);
+        }
+        mm__free(dev->ctx, dev->cm.vports); dev->cm.vports = NULL;
+    } else if (dev->is_virtual)
+        MIDIEndpointDispose(dev->cm.virt_ep);
+    else
+        MIDIPortDispose(dev->cm.port);
+    mm__free(dev->ctx, dev->cm.parser.sysex);
+    mm_parser_init(&dev->cm.parser, NULL, 0);
+    dev->is_open=0; return MM_SUCCESS;
+}
+
+mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
+    if (!ctx||!dev) return MM_INVALID_ARG;
+    if (idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    memset(dev, 0, sizeof(*dev)); dev->ctx=ctx; dev->is_input=0;
+    dev->cm.endpoint = MIDIGetDestination(idx);
+    char portname[80]; snprintf(portname, sizeof(portname), "%s-out", ctx->name);
+    CFStringRef cfport = CFStringCreateWithCString(NULL, portname, kCFStringEncodingUTF8);
+    OSStatus st = MIDIOutputPortCreate(ctx->cm.client, cfport, &dev->cm.port);
+    CFRelease(cfport);
+    if (st != noErr) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+/* Same packet list to every member: built once, sent N times. */
+static mm_result mm__cm_group_send(mm_device* dev, const MIDIPacketList* pl) {
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < dev->cm.member_count; i++)
+        if (MIDISend(dev->cm.port, dev->cm.members[i], pl) != noErr) res = MM_ERROR;
+    return res;
+}
+
+/* ts: host time to deliver at; 0 = now. */
+static mm_result mm__cm_send(mm_device* dev, const mm_message* msg, MIDITimeStamp ts) {
+    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
+    if (!msg) return MM_INVALID_ARG;
+    uint8_t raw[3];
+    int len = mm__encode(msg, raw);
+    if (!len) return MM_INVALID_ARG;
+    MIDIPacketList pl; MIDIPacket* p = MIDIPacketListInit(&pl);
+    p = MIDIPacketListAdd(&pl, sizeof(pl), p, ts, (ByteCount)len, raw);
+    if (!p) return MM_ERROR;
+    if (dev->is_virtual)
+        return (MIDIReceived(dev->cm.virt_ep, &pl) == noErr) ? MM_SUCCESS : MM_ERROR;
+    if (dev->is_group) return mm__cm_group_send(dev, &pl);
+    return (MIDISend(dev->cm.port, dev->cm.endpoint, &pl) == noErr) ? MM_SUCCESS : MM_ERROR;
+}
+mm_result mm_out_send(mm_device* dev, const mm_message* msg) {
+    return mm__cm_send(dev, msg, 0);
+}
+mm_result mm_out_send_at(mm_device* dev, const mm_message* msg, double time) {
+    return mm__cm_send(dev, msg, time > mm_in_time(dev) ? mm__cm_host(time) : 0);
+}
+
+mm_result mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size) {
+    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
+    if (!data||!size||size>dev->ctx->config.sysex_size) return MM_INVALID_ARG;
+    if (!dev->cm.sysex) {
+        dev->cm.sysex = (mm__cm_sysex*)mm__calloc(dev->ctx, 1, sizeof(mm__cm_sysex)
+                            + dev->ctx->config.sysex_size + MM__CM_PL_SLACK);
+        if (!dev->cm.sysex) return MM_ALLOC_FAILED;
+        dev->cm.sysex->buf = (uint8_t*)(dev->cm.sysex + 1);
+    }
+    mm__cm_sysex* sx = dev->cm.sysex;
+    if (dev->is_virtual || dev->is_group) {
+        /* Virtual sources push to subscribers with MIDIReceived; groups
+           send one packet list to every member, since MIDISendSysex is
+           per-destination and asynchronous. A packet holds at most 64 KiB,
+           so a bigger message goes out as consecutive packets.            */
+        size_t chunk = dev->ctx->config.sysex_size;
+        if (chunk > MM__CM_PACKET_MAX) chunk = MM__CM_PACKET_MAX;
+        const ByteCount plsz = (ByteCount)(chunk + MM__CM_PL_SLACK);
+        MIDIPacketList* pl = (MIDIPacketList*)sx->buf;
+        for (size_t off = 0; off < size; off += chunk) {
+            size_t n = size - off < chunk ? size - off : chunk;
+            MIDIPacket* p = MIDIPacketListInit(pl);
+            p = MIDIPacketListAdd(pl, plsz, p, 0, (ByteCount)n, data + off);
+            if (!p) return MM_ERROR;
+            mm_result r = dev->is_virtual
+                ? ((MIDIReceived(dev->cm.virt_ep, pl) == noErr) ? MM_SUCCESS : MM_ERROR)
+                : mm__cm_group_send(dev, pl);
+            if (r != MM_SUCCESS) return r;
+        }
+        return MM_SUCCESS;
+    }
+    memcpy(sx->buf, data, size);
+    sx->req.destination      = dev->cm.endpoint;
+    sx->req.data             = sx->buf;
+    sx->req.bytesToSend      = (UInt32)size;
+    sx->req.complete         = false;
+    sx->req.completionProc   = NULL;
+    sx->req.completionRefCon = NULL;
+    return (MIDISendSysex(&sx->req) == noErr) ? MM_SUCCESS : MM_ERROR;
+}
+mm_result mm_out_close(mm_device* dev) {
     if (!dev||!dev->is_open) return MM_NOT_OPEN;
     if (dev->is_virtual) {
         MIDIEndpointDispose(dev->cm.virt_ep);
     } else {
         MIDIPortDispose(dev->cm.port);
     }
+    mm__free(dev->ctx, dev->cm.sysex); dev->cm.sysex = NULL;
+    mm__free(dev->ctx, dev->cm.members); dev->cm.members = NULL;
+    dev->cm.member_count = dev->cm.member_cap = 0;
+    mm__ump_release(dev);
     dev->is_open=0; return MM_SUCCESS;
 }
 
+/* ── Output groups (CoreMIDI) ──────────────────────────────────────────────
+   One output port; the member endpoints are just a list we MIDISend to.     */
+
+mm_result mm_out_open_group(mm_context* ctx, mm_device* dev) {
+    if (!ctx||!dev) return MM_INVALID_ARG;
+    memset(dev, 0, sizeof(*dev)); dev->ctx=ctx; dev->is_input=0; dev->is_group=1;
+    char portname[80]; snprintf(portname, sizeof(portname), "%s-out", ctx->name);
+    CFStringRef cfport = CFStringCreateWithCString(NULL, portname, kCFStringEncodingUTF8);
+    OSStatus st = MIDIOutputPortCreate(ctx->cm.client, cfport, &dev->cm.port);
+    CFRelease(cfport);
+    if (st != noErr) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+mm_result mm_out_group_add(mm_device* dev, uint32_t out_idx) {
+    if (!dev||!dev->is_open||!dev->is_group) return MM_NOT_OPEN;
+    if (out_idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    MIDIEndpointRef ep = MIDIGetDestination(out_idx);
+    for (uint32_t i = 0; i < dev->cm.member_count; i++)
+        if (dev->cm.members[i] == ep) return MM_ALREADY_OPEN;
+    if (dev->cm.member_count == dev->cm.member_cap) {
+        uint32_t cap = dev->cm.member_cap ? dev->cm.member_cap * 2 : 8;
+        MIDIEndpointRef* m = (MIDIEndpointRef*)mm__realloc(dev->ctx, dev->cm.members,
+                                                        cap * sizeof(*m));
+        if (!m) return MM_ALLOC_FAILED;
+        dev->cm.members = m; dev->cm.member_cap = cap;
+    }
+    dev->cm.members[dev->cm.member_count++] = ep;
+    return MM_SUCCESS;
+}
+
+mm_result mm_out_group_remove(mm_device* dev, uint32_t out_idx) {
+    if (!dev||!dev->is_open||!dev->is_group) return MM_NOT_OPEN;
+    if (out_idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    MIDIEndpointRef ep = MIDIGetDestination(out_idx);
+    for (uint32_t i = 0; i < dev->cm.member_count; i++) {
+        if (dev->cm.members[i] != ep) continue;
+        dev->cm.members[i] = dev->cm.members[--dev->cm.member_count];
+        return MM_SUCCESS;
+    }
+    return MM_NOT_OPEN;
+}
+
 /* ── Virtual ports (CoreMIDI) ──────────────────────────────────────────────
    mm_in_open_virtual  → MIDIDestinationCreate: other apps send TO us.
    mm_out_open_virtual → MIDISourceCreate:      other apps receive FROM us.  */
@@ -788,6 +3742,7 @@ mm_result mm_in_open_virtual(mm_context* ctx, mm_device* dev,
     memset(dev, 0, sizeof(*dev));
     dev->ctx=ctx; dev->callback=cb; dev->userdata=ud;
     dev->is_input=1; dev->is_virtual=1;
+    if (mm__cm_parser_prepare(ctx, &dev->cm.parser) != MM_SUCCESS) return MM_ALLOC_FAILED;
 
     CFStringRef cfname = CFStringCreateWithCString(NULL, ctx->name,
                                                     kCFStringEncodingUTF8);
@@ -795,7 +3750,49 @@ mm_result mm_in_open_virtual(mm_context* ctx, mm_device* dev,
                                         mm__cm_read_proc, dev,
                                         &dev->cm.virt_ep);
     CFRelease(cfname);
-    if (st != noErr) return MM_ERROR;
+    if (st != noErr) {
+        mm__free(ctx, dev->cm.parser.sysex); dev->cm.parser.sysex = NULL;
+        return MM_ERROR;
+    }
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+mm_result mm_in_open_virtual_multi(mm_context* ctx, mm_device* dev,
+                                   const char* const* names, uint32_t count,
+                                   mm_callback cb, void* ud)
+{
+    if (!ctx||!dev||!cb||!count||count > 0xFFFF) return MM_INVALID_ARG;
+    memset(dev, 0, sizeof(*dev));
+    dev->ctx=ctx; dev->callback=cb; dev->userdata=ud;
+    dev->is_input=1; dev->is_virtual=1;
+
+    dev->cm.vports = (mm__cm_vport*)mm__calloc(ctx, count, sizeof(mm__cm_vport));
+    if (!dev->cm.vports) return MM_ALLOC_FAILED;
+    for (uint32_t i = 0; i < count; i++) {
+        char name[80];
+        if (names && names[i]) snprintf(name, sizeof(name), "%s", names[i]);
+        else                   snprintf(name, sizeof(name), "%s-%u", ctx->name, i + 1);
+        mm__cm_vport* vp = &dev->cm.vports[i];
+        vp->dev = dev; vp->parser.port_index = (uint16_t)i;
+        mm_result r = mm__cm_parser_prepare(ctx, &vp->parser);
+        if (r == MM_SUCCESS) {
+            CFStringRef cfname = CFStringCreateWithCString(NULL, name, kCFStringEncodingUTF8);
+            OSStatus st = MIDIDestinationCreate(ctx->cm.client, cfname,
+                                                mm__cm_vport_read_proc, vp, &vp->ep);
+            CFRelease(cfname);
+            if (st != noErr) r = MM_ERROR;
+        }
+        if (r != MM_SUCCESS) {
+            mm__free(ctx, vp->parser.sysex);
+            while (i--) {
+                MIDIEndpointDispose(dev->cm.vports[i].ep);
+                mm__free(ctx, dev->cm.vports[i].parser.sysex);
+            }
+            mm__free(ctx, dev->cm.vports); dev->cm.vports = NULL;
+            return r;
+        }
+        dev->cm.vport_count = i + 1;
+    }
     dev->is_open=1; return MM_SUCCESS;
 }
 
@@ -817,21 +3814,80 @@ mm_result mm_out_open_virtual(mm_context* ctx, mm_device* dev)
     dev->is_open=1; return MM_SUCCESS;
 }
 
+/* ── Kernel-level routing (CoreMIDI) ───────────────────────────────────────
+   A thru connection lives in the MIDI server, so events never reach us.
+   ownerID = NULL makes it non-persistent: it also dies with the process.    */
+
+mm_result mm_route_connect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx,
+                           const mm_route_options* opts)
+{
+    (void)opts;
+    if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    if (in_idx  >= MIDIGetNumberOfSources())      return MM_OUT_OF_RANGE;
+    if (out_idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    MIDIEndpointRef src = MIDIGetSource(in_idx);
+    MIDIEndpointRef dst = MIDIGetDestination(out_idx);
+    for (uint32_t i = 0; i < ctx->cm.route_count; i++)
+        if (ctx->cm.routes[i].src == src && ctx->cm.routes[i].dst == dst)
+            return MM_ALREADY_OPEN;
+    mm_result res = mm__route_reserve(ctx, (void**)&ctx->cm.routes, ctx->cm.route_count,
+                                      &ctx->cm.route_cap, sizeof(mm__cm_route));
+    if (res != MM_SUCCESS) return res;
+
+    MIDIThruConnectionParams p;
+    MIDIThruConnectionParamsInitialize(&p);
+    p.numSources                  = 1;
+    p.sources[0].endpointRef      = src;
+    p.numDestinations             = 1;
+    p.destinations[0].endpointRef = dst;
+    CFDataRef data = CFDataCreate(NULL, (const UInt8*)&p,
+                                  (CFIndex)MIDIThruConnectionParamsSize(&p));
+    if (!data) return MM_ALLOC_FAILED;
+    mm__cm_route* r = &ctx->cm.routes[ctx->cm.route_count];
+    OSStatus st = MIDIThruConnectionCreate(NULL, data, &r->thru);
+    CFRelease(data);
+    if (st != noErr) return MM_ERROR;
+    r->src = src; r->dst = dst; ctx->cm.route_count++;
+    return MM_SUCCESS;
+}
+
+mm_result mm_route_disconnect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx)
+{
+    if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    if (in_idx  >= MIDIGetNumberOfSources())      return MM_OUT_OF_RANGE;
+    if (out_idx >= MIDIGetNumberOfDestinations()) return MM_OUT_OF_RANGE;
+    MIDIEndpointRef src = MIDIGetSource(in_idx);
+    MIDIEndpointRef dst = MIDIGetDestination(out_idx);
+    for (uint32_t i = 0; i < ctx->cm.route_count; i++) {
+        if (ctx->cm.routes[i].src != src || ctx->cm.routes[i].dst != dst) continue;
+        MIDIThruConnectionDispose(ctx->cm.routes[i].thru);
+        ctx->cm.routes[i] = ctx->cm.routes[--ctx->cm.route_count];
+        return MM_SUCCESS;
+    }
+    return MM_NOT_OPEN;
+}
+
 /* ─────────────────────────────────────────────────────────────────────────────
    WinMM (Windows)
    ───────────────────────────────────────────────────────────────────────── */
 #elif defined(MM_BACKEND_WINMM)
 
-mm_result mm_context_init(mm_context* ctx, const char* name) {
+mm_result mm_context_init_ex(mm_context* ctx, const mm_context_config* config) {
     if (!ctx) return MM_INVALID_ARG;
-    memset(ctx, 0, sizeof(*ctx));
-    strncpy(ctx->name, (name && name[0]) ? name : "minimidio", sizeof(ctx->name)-1);
+    mm_result res = mm__context_setup(ctx, config);
+    if (res != MM_SUCCESS) return res;
+    if (ctx->config.delivery == MM_DELIVERY_POLL) return MM_NO_BACKEND;
     ctx->initialized=1; return MM_SUCCESS;
     /* Note: WinMM has no client-name concept; ctx->name is stored but unused
        by the backend. The app is identified to other software only by the
        hardware port it opens.                                                 */
 }
 mm_result mm_context_uninit(mm_context* ctx) { if(!ctx)return MM_INVALID_ARG; ctx->initialized=0; return MM_SUCCESS; }
+mm_result mm_context_dispatch(mm_context* ctx, int timeout_ms, uint32_t* dispatched) {
+    (void)ctx; (void)timeout_ms;
+    if (dispatched) *dispatched = 0;
+    return MM_NO_BACKEND;
+}
 
 uint32_t mm_in_count (mm_context* ctx) { (void)ctx; return (uint32_t)midiInGetNumDevs();  }
 uint32_t mm_out_count(mm_context* ctx) { (void)ctx; return (uint32_t)midiOutGetNumDevs(); }
@@ -847,6 +3903,24 @@ mm_result mm_out_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
     strncpy(buf,c.szPname,sz-1); buf[sz-1]='\0'; return MM_SUCCESS;
 }
 
+static mm_result mm__registry_enum(mm_port_registry* reg) {
+    UINT n = midiInGetNumDevs();
+    for (UINT i = 0; i < n; i++) {
+        MIDIINCAPSA c;
+        if (midiInGetDevCapsA(i,&c,sizeof(c))!=MMSYSERR_NOERROR) c.szPname[0]='\0';
+        if (mm__registry_add(reg, c.szPname, -1, (int)i, MM_PORT_INPUT, 0, 0) != MM_SUCCESS)
+            return MM_ALLOC_FAILED;
+    }
+    n = midiOutGetNumDevs();
+    for (UINT i = 0; i < n; i++) {
+        MIDIOUTCAPSA c;
+        if (midiOutGetDevCapsA(i,&c,sizeof(c))!=MMSYSERR_NOERROR) c.szPname[0]='\0';
+        if (mm__registry_add(reg, c.szPname, -1, (int)i, MM_PORT_OUTPUT, 0, 0) != MM_SUCCESS)
+            return MM_ALLOC_FAILED;
+    }
+    return MM_SUCCESS;
+}
+
 static void CALLBACK mm__wm_in_proc(HMIDIIN hmi, UINT wmsg,
                                      DWORD_PTR inst, DWORD_PTR p1, DWORD_PTR p2)
 {
@@ -857,54 +3931,24 @@ static void CALLBACK mm__wm_in_proc(HMIDIIN hmi, UINT wmsg,
         uint8_t s  = (uint8_t)( p1        & 0xFF);
         uint8_t d1 = (uint8_t)((p1 >>  8) & 0xFF);
         uint8_t d2 = (uint8_t)((p1 >> 16) & 0xFF);
-        double  ts = (double)p2 / 1000.0;
-
-        mm_message msg; memset(&msg,0,sizeof(msg)); msg.timestamp=ts;
-
-        /* Real-time */
-        if (s >= 0xF8) {
-            switch (s) {
-                case 0xF8: msg.type=MM_CLOCK;        break;
-                case 0xFA: msg.type=MM_START;        break;
-                case 0xFB: msg.type=MM_CONTINUE;     break;
-                case 0xFC: msg.type=MM_STOP;         break;
-                case 0xFE: msg.type=MM_ACTIVE_SENSE; break;
-                case 0xFF: msg.type=MM_RESET;        break;
-                default: return;
-            }
-            dev->callback(dev, &msg, dev->userdata); return;
-        }
-
-        /* System common */
-        if (s >= 0xF0) {
-            switch (s) {
-                case 0xF1:
-                    msg.type=MM_MTC_QUARTER_FRAME; msg.data[0]=d1; break;
-                case 0xF2:
-                    msg.type=MM_SONG_POSITION; msg.data[0]=d1; msg.data[1]=d2;
-                    msg.song_position=(uint16_t)(d1|((uint16_t)d2<<7)); break;
-                case 0xF3:
-                    msg.type=MM_SONG_SELECT; msg.data[0]=d1; break;
-                case 0xF6:
-                    msg.type=MM_TUNE_REQUEST; break;
-                default: return;
-            }
-            dev->callback(dev, &msg, dev->userdata); return;
-        }
 
-        /* Channel messages */
-        msg = mm_make_message(s, d1, d2); msg.timestamp=ts;
+        /* WinMM hands over whole short messages: one table lookup decodes
+           any of them; undefined statuses come back with type 0.           */
+        mm_message msg = mm__decode(s, d1, d2);
+        if (!msg.type || msg.type == MM_SYSEX) return;
+        msg.timestamp = (double)p2 / 1000.0;
         dev->callback(dev, &msg, dev->userdata);
 
     } else if (wmsg == MIM_LONGDATA) {
         MIDIHDR* hdr = (MIDIHDR*)p1;
         if (hdr && hdr->dwBytesRecorded>0 && (uint8_t)hdr->lpData[0]==0xF0) {
             mm_message msg; memset(&msg,0,sizeof(msg));
+            msg.source_client = msg.source_port = -1;
             msg.type=MM_SYSEX; msg.timestamp=(double)p2/1000.0;
             msg.sysex=(const uint8_t*)hdr->lpData; msg.sysex_size=hdr->dwBytesRecorded;
             dev->callback(dev, &msg, dev->userdata);
         }
-        midiInAddBuffer(dev->wm.in, hdr, sizeof(MIDIHDR));
+        if (dev->is_open) midiInAddBuffer(dev->wm.in, hdr, sizeof(MIDIHDR));
     }
 }
 
@@ -913,19 +3957,35 @@ mm_result mm_in_open(mm_context* ctx, mm_device* dev, uint32_t idx,
 {
     if (!ctx||!dev||!cb) return MM_INVALID_ARG;
     memset(dev,0,sizeof(*dev)); dev->ctx=ctx; dev->callback=cb; dev->userdata=ud; dev->is_input=1;
+    /* WinMM only delivers sysex into a buffer queued up front. */
+    dev->wm.sysex = (mm__wm_sysex*)mm__calloc(ctx, 1,
+                        sizeof(mm__wm_sysex) + ctx->config.sysex_size);
+    if (!dev->wm.sysex) return MM_ALLOC_FAILED;
+    dev->wm.sysex->buf = (uint8_t*)(dev->wm.sysex + 1);
     if (midiInOpen(&dev->wm.in,(UINT)idx,(DWORD_PTR)mm__wm_in_proc,(DWORD_PTR)dev,
-                   CALLBACK_FUNCTION) != MMSYSERR_NOERROR) return MM_ERROR;
-    memset(&dev->wm.sysex_hdr,0,sizeof(dev->wm.sysex_hdr));
-    dev->wm.sysex_hdr.lpData=(LPSTR)dev->wm.sysex_buf;
-    dev->wm.sysex_hdr.dwBufferLength=MM_SYSEX_BUF_SIZE;
-    midiInPrepareHeader(dev->wm.in,&dev->wm.sysex_hdr,sizeof(MIDIHDR));
-    midiInAddBuffer(dev->wm.in,&dev->wm.sysex_hdr,sizeof(MIDIHDR));
+                   CALLBACK_FUNCTION) != MMSYSERR_NOERROR) {
+        mm__free(ctx, dev->wm.sysex); dev->wm.sysex=NULL; return MM_ERROR;
+    }
+    MIDIHDR* hdr=&dev->wm.sysex->hdr;
+    hdr->lpData=(LPSTR)dev->wm.sysex->buf;
+    hdr->dwBufferLength=(DWORD)ctx->config.sysex_size;
+    midiInPrepareHeader(dev->wm.in,hdr,sizeof(MIDIHDR));
+    midiInAddBuffer(dev->wm.in,hdr,sizeof(MIDIHDR));
     dev->is_open=1; return MM_SUCCESS;
 }
+mm_result mm_in_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port,
+                          mm_callback cb, void* ud) {
+    if (!port||!(port->flags & MM_PORT_INPUT)) return MM_INVALID_ARG;
+    return mm_in_open(ctx, dev, (uint32_t)port->port, cb, ud);
+}
 mm_result mm_in_start(mm_device* dev) {
     if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
+    dev->wm.start_ms = timeGetTime();
     return (midiInStart(dev->wm.in)==MMSYSERR_NOERROR)?MM_SUCCESS:MM_ERROR;
 }
+double mm_in_time(const mm_device* dev) {
+    return dev ? (double)(DWORD)(timeGetTime() - dev->wm.start_ms) / 1000.0 : 0.0;
+}
 mm_result mm_in_stop(mm_device* dev) {
     if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
     midiInStop(dev->wm.in); return MM_SUCCESS;
@@ -933,60 +3993,91 @@ mm_result mm_in_stop(mm_device* dev) {
 mm_result mm_in_close(mm_device* dev) {
     if (!dev||!dev->is_open) return MM_NOT_OPEN;
     midiInStop(dev->wm.in);
-    midiInUnprepareHeader(dev->wm.in,&dev->wm.sysex_hdr,sizeof(MIDIHDR));
-    midiInClose(dev->wm.in); dev->is_open=0; return MM_SUCCESS;
+    dev->is_open=0;            /* callback stops re-queueing the buffer */
+    midiInReset(dev->wm.in);   /* returns the queued sysex buffer       */
+    midiInUnprepareHeader(dev->wm.in,&dev->wm.sysex->hdr,sizeof(MIDIHDR));
+    midiInClose(dev->wm.in);
+    mm__free(dev->ctx, dev->wm.sysex); dev->wm.sysex=NULL;
+    return MM_SUCCESS;
+}
+
+mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
+    if (!ctx||!dev) return MM_INVALID_ARG;
+    memset(dev,0,sizeof(*dev)); dev->ctx=ctx; dev->is_input=0;
+    if (midiOutOpen(&dev->wm.out,(UINT)idx,0,0,CALLBACK_NULL)!=MMSYSERR_NOERROR)
+        return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+mm_result mm_out_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port) {
+    if (!port||!(port->flags & MM_PORT_OUTPUT)) return MM_INVALID_ARG;
+    return mm_out_open(ctx, dev, (uint32_t)port->port);
+}
+
+/* WinMM has no address syntax: the spec is a glob over device names. */
+mm_result mm_in_open_by_address(mm_context* ctx, mm_device* dev, const char* spec,
+                                mm_callback cb, void* ud) {
+    if (!ctx||!dev||!cb||!spec) return MM_INVALID_ARG;
+    UINT n = midiInGetNumDevs();
+    for (UINT i = 0; i < n; i++) {
+        MIDIINCAPSA c;
+        if (midiInGetDevCapsA(i,&c,sizeof(c))!=MMSYSERR_NOERROR) continue;
+        if (mm__glob_match(spec, c.szPname)) return mm_in_open(ctx, dev, i, cb, ud);
+    }
+    return MM_OUT_OF_RANGE;
+}
+mm_result mm_out_open_by_address(mm_context* ctx, mm_device* dev, const char* spec) {
+    if (!ctx||!dev||!spec) return MM_INVALID_ARG;
+    UINT n = midiOutGetNumDevs();
+    for (UINT i = 0; i < n; i++) {
+        MIDIOUTCAPSA c;
+        if (midiOutGetDevCapsA(i,&c,sizeof(c))!=MMSYSERR_NOERROR) continue;
+        if (mm__glob_match(spec, c.szPname)) return mm_out_open(ctx, dev, i);
+    }
+    return MM_OUT_OF_RANGE;
 }
 
-mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
-    if (!ctx||!dev) return MM_INVALID_ARG;
-    memset(dev,0,sizeof(*dev)); dev->ctx=ctx; dev->is_input=0;
-    if (midiOutOpen(&dev->wm.out,(UINT)idx,0,0,CALLBACK_NULL)!=MMSYSERR_NOERROR)
-        return MM_ERROR;
-    dev->is_open=1; return MM_SUCCESS;
+/* WinMM has no device-change notification short of a window message loop. */
+mm_result mm_registry_watch(mm_port_registry* reg, mm_port_callback cb, void* ud) {
+    (void)reg; (void)cb; (void)ud;
+    return MM_NO_BACKEND;
 }
+mm_result mm_registry_unwatch(mm_port_registry* reg) { (void)reg; return MM_NO_BACKEND; }
+void mm_registry_lock  (mm_port_registry* reg) { (void)reg; }
+void mm_registry_unlock(mm_port_registry* reg) { (void)reg; }
 
 mm_result mm_out_send(mm_device* dev, const mm_message* msg) {
     if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
     if (!msg) return MM_INVALID_ARG;
-    DWORD pk;
-    switch (msg->type) {
-        case MM_SONG_POSITION:
-            pk=0xF2|((DWORD)(msg->song_position&0x7F)<<8)
-                   |((DWORD)((msg->song_position>>7)&0x7F)<<16); break;
-        case MM_MTC_QUARTER_FRAME: pk=0xF1|((DWORD)msg->data[0]<<8); break;
-        case MM_SONG_SELECT:       pk=0xF3|((DWORD)msg->data[0]<<8); break;
-        case MM_TUNE_REQUEST:  pk=0xF6; break;
-        case MM_CLOCK:         pk=0xF8; break;
-        case MM_START:         pk=0xFA; break;
-        case MM_CONTINUE:      pk=0xFB; break;
-        case MM_STOP:          pk=0xFC; break;
-        case MM_ACTIVE_SENSE:  pk=0xFE; break;
-        case MM_RESET:         pk=0xFF; break;
-        default: {
-            uint8_t st=(uint8_t)(((uint8_t)msg->type<<4)|(msg->channel&0xF));
-            pk=st|((DWORD)msg->data[0]<<8)|((DWORD)msg->data[1]<<16);
-        }
-    }
+    uint8_t raw[3];
+    if (!mm__encode(msg, raw)) return MM_INVALID_ARG;
+    DWORD pk=raw[0]|((DWORD)raw[1]<<8)|((DWORD)raw[2]<<16);
     return (midiOutShortMsg(dev->wm.out,pk)==MMSYSERR_NOERROR)?MM_SUCCESS:MM_ERROR;
 }
+/* midiOutShortMsg goes out at once; midiStream would need a tempo map. */
+mm_result mm_out_send_at(mm_device* dev, const mm_message* msg, double time) {
+    (void)dev; (void)msg; (void)time; return MM_NO_BACKEND;
+}
 
 mm_result mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size) {
     if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
-    if (!data||!size||size>MM_SYSEX_BUF_SIZE) return MM_INVALID_ARG;
-    memcpy(dev->wm.sysex_buf,data,size);
-    memset(&dev->wm.sysex_hdr,0,sizeof(dev->wm.sysex_hdr));
-    dev->wm.sysex_hdr.lpData=(LPSTR)dev->wm.sysex_buf;
-    dev->wm.sysex_hdr.dwBufferLength=(DWORD)size;
-    dev->wm.sysex_hdr.dwBytesRecorded=(DWORD)size;
-    midiOutPrepareHeader(dev->wm.out,&dev->wm.sysex_hdr,sizeof(MIDIHDR));
-    MMRESULT r=midiOutLongMsg(dev->wm.out,&dev->wm.sysex_hdr,sizeof(MIDIHDR));
-    while (midiOutUnprepareHeader(dev->wm.out,&dev->wm.sysex_hdr,sizeof(MIDIHDR))
+    if (!data||!size||size>dev->ctx->config.sysex_size) return MM_INVALID_ARG;
+    /* Synchronous (we wait for unprepare), so the caller's buffer can be
+       sent in place — no per-device staging copy.                          */
+    MIDIHDR hdr; memset(&hdr,0,sizeof(hdr));
+    hdr.lpData=(LPSTR)data;
+    hdr.dwBufferLength=(DWORD)size;
+    hdr.dwBytesRecorded=(DWORD)size;
+    midiOutPrepareHeader(dev->wm.out,&hdr,sizeof(MIDIHDR));
+    MMRESULT r=midiOutLongMsg(dev->wm.out,&hdr,sizeof(MIDIHDR));
+    while (midiOutUnprepareHeader(dev->wm.out,&hdr,sizeof(MIDIHDR))
            ==MIDIERR_STILLPLAYING) Sleep(1);
     return (r==MMSYSERR_NOERROR)?MM_SUCCESS:MM_ERROR;
 }
 mm_result mm_out_close(mm_device* dev) {
     if (!dev||!dev->is_open) return MM_NOT_OPEN;
-    midiOutClose(dev->wm.out); dev->is_open=0; return MM_SUCCESS;
+    midiOutClose(dev->wm.out); mm__ump_release(dev);
+    dev->is_open=0; return MM_SUCCESS;
 }
 
 /* WinMM has no virtual port API. Users should install loopMIDI
@@ -998,50 +4089,186 @@ mm_result mm_in_open_virtual(mm_context* ctx, mm_device* dev,
     (void)ctx; (void)dev; (void)cb; (void)ud;
     return MM_NO_BACKEND;
 }
+
+mm_result mm_in_open_virtual_multi(mm_context* ctx, mm_device* dev,
+                                   const char* const* names, uint32_t count,
+                                   mm_callback cb, void* ud)
+{
+    (void)ctx; (void)dev; (void)names; (void)count; (void)cb; (void)ud;
+    return MM_NO_BACKEND;
+}
 mm_result mm_out_open_virtual(mm_context* ctx, mm_device* dev)
 {
     (void)ctx; (void)dev;
     return MM_NO_BACKEND;
 }
 
+mm_result mm_out_open_group(mm_context* ctx, mm_device* dev)
+{
+    (void)ctx; (void)dev;
+    return MM_NO_BACKEND;
+}
+mm_result mm_out_group_add(mm_device* dev, uint32_t out_idx)
+{
+    (void)dev; (void)out_idx;
+    return MM_NO_BACKEND;
+}
+mm_result mm_out_group_remove(mm_device* dev, uint32_t out_idx)
+{
+    (void)dev; (void)out_idx;
+    return MM_NO_BACKEND;
+}
+
+/* WinMM drivers offer no port-to-port routing outside an open handle pair. */
+mm_result mm_route_connect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx,
+                           const mm_route_options* opts)
+{
+    (void)ctx; (void)in_idx; (void)out_idx; (void)opts;
+    return MM_NO_BACKEND;
+}
+mm_result mm_route_disconnect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx)
+{
+    (void)ctx; (void)in_idx; (void)out_idx;
+    return MM_NO_BACKEND;
+}
+
 /* ─────────────────────────────────────────────────────────────────────────────
    ALSA sequencer (Linux) — compile with -lasound -lpthread only
    ───────────────────────────────────────────────────────────────────────── */
 #elif defined(MM_BACKEND_ALSA)
 
 #include <time.h>
+#include <sched.h>
 #include <unistd.h>
 #include <errno.h>
 
-mm_result mm_context_init(mm_context* ctx, const char* name) {
+/* pollfd set for a poll thread: the handle's fds plus the wake pipe's read
+   end, last (-1 when there is no pipe; poll() skips it). Built by the
+   caller before the thread starts, so the thread itself never allocates. */
+static mm_result mm__alsa_pollfds(const mm_context* ctx, snd_seq_t* seq, int wake_fd,
+                                  struct pollfd** out, int* nfds)
+{
+    int nalsa = snd_seq_poll_descriptors_count(seq, POLLIN);
+    if (nalsa < 0) nalsa = 0;
+    struct pollfd* pfds = (struct pollfd*)mm__calloc(ctx, (size_t)nalsa + 1,
+                                                     sizeof(struct pollfd));
+    if (!pfds) return MM_ALLOC_FAILED;
+    snd_seq_poll_descriptors(seq, pfds, (unsigned)nalsa, POLLIN);
+    pfds[nalsa].fd     = wake_fd;
+    pfds[nalsa].events = POLLIN;
+    *out = pfds; *nfds = nalsa + 1;
+    return MM_SUCCESS;
+}
+
+mm_result mm_context_init_ex(mm_context* ctx, const mm_context_config* config) {
     if (!ctx) return MM_INVALID_ARG;
-    memset(ctx, 0, sizeof(*ctx));
-    strncpy(ctx->name, (name && name[0]) ? name : "minimidio", sizeof(ctx->name)-1);
+    mm_result res = mm__context_setup(ctx, config);
+    if (res != MM_SUCCESS) return res;
     if (snd_seq_open(&ctx->al.seq, "default", SND_SEQ_OPEN_DUPLEX, 0) < 0)
         return MM_ERROR;
     snd_seq_set_client_name(ctx->al.seq, ctx->name);
     ctx->al.client_id = snd_seq_client_id(ctx->al.seq);
+    ctx->al.queue     = -1;
+    const mm_context_config* c = &ctx->config;
+#ifdef MM__ALSA_UMP
+    /* Kernels without UMP support refuse; the client stays MIDI 1.0 and
+       the UMP calls translate in software instead.                         */
+    if ((c->ump == MM_UMP_PROTOCOL_MIDI1 || c->ump == MM_UMP_PROTOCOL_MIDI2) &&
+        snd_seq_set_client_midi_version(ctx->al.seq, c->ump == MM_UMP_PROTOCOL_MIDI2
+                ? SND_SEQ_CLIENT_UMP_MIDI_2_0 : SND_SEQ_CLIENT_UMP_MIDI_1_0) == 0)
+        ctx->al.ump = c->ump;
+#endif
+    /* Bigger input buffer / pool = more headroom for sysex dumps and bursts
+       before the kernel starts dropping; output sizes bound what can be
+       queued without blocking.                                             */
+    if (c->alsa.input_buffer)  snd_seq_set_input_buffer_size (ctx->al.seq, c->alsa.input_buffer);
+    if (c->alsa.output_buffer) snd_seq_set_output_buffer_size(ctx->al.seq, c->alsa.output_buffer);
+    if (c->alsa.input_pool)    snd_seq_set_client_pool_input (ctx->al.seq, c->alsa.input_pool);
+    if (c->alsa.output_pool)   snd_seq_set_client_pool_output(ctx->al.seq, c->alsa.output_pool);
+    /* Poll delivery has no thread, so the pollfd set (without a wake pipe)
+       is built here for mm_context_dispatch.                               */
+    if (c->delivery == MM_DELIVERY_POLL &&
+        mm__alsa_pollfds(ctx, ctx->al.seq, -1, &ctx->al.pfds, &ctx->al.nfds) != MM_SUCCESS) {
+        snd_seq_close(ctx->al.seq); return MM_ALLOC_FAILED;
+    }
+    /* Recursive, so a callback may start or stop devices on its own context. */
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_settype(&ma, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->al.lock, &ma);
+    pthread_mutexattr_destroy(&ma);
     ctx->initialized = 1; return MM_SUCCESS;
 }
 
+static void mm__alsa_unsubscribe(mm__ctx_alsa* al, const mm__alsa_route* r) {
+    snd_seq_port_subscribe_t* sub;
+    snd_seq_port_subscribe_alloca(&sub);
+    snd_seq_port_subscribe_set_sender(sub, &r->sender);
+    snd_seq_port_subscribe_set_dest(sub, &r->dest);
+    snd_seq_unsubscribe_port(al->seq, sub);
+}
+
+
+/* True on the thread running a callback: stopping or closing from there
+   would wait on al->lock, which that same thread holds.                   */
+static int mm__alsa_in_callback(const mm__ctx_alsa* al) {
+    return al->in_callback && pthread_equal(al->cb_thread, pthread_self());
+}
+
 mm_result mm_context_uninit(mm_context* ctx) {
     if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    if (mm__alsa_in_callback(&ctx->al)) return MM_INVALID_ARG;
+    /* Subscriptions between two foreign ports outlive our client, so routes
+       have to be removed explicitly before the handle goes away.            */
+    for (uint32_t i = 0; i < ctx->al.route_count; i++)
+        mm__alsa_unsubscribe(&ctx->al, &ctx->al.routes[i]);
+    ctx->al.route_count = 0;
+    mm__free(ctx, ctx->al.routes); ctx->al.routes = NULL; ctx->al.route_cap = 0;
+    if (ctx->al.queue >= 0) snd_seq_free_queue(ctx->al.seq, ctx->al.queue);
+    if (ctx->al.thread_running) {
+        char c=1; (void)write(ctx->al.wake_pipe[1], &c, 1); /* wake the poll() */
+        pthread_join(ctx->al.thread, NULL);
+        mm__free(ctx, ctx->al.pfds); ctx->al.pfds = NULL;
+        close(ctx->al.wake_pipe[0]); close(ctx->al.wake_pipe[1]);
+        ctx->al.thread_running = 0;
+    }
+    mm__free(ctx, ctx->al.pfds); ctx->al.pfds = NULL;  /* MM_DELIVERY_POLL */
+    pthread_mutex_destroy(&ctx->al.lock);
     snd_seq_close(ctx->al.seq);
     ctx->initialized = 0; return MM_SUCCESS;
 }
 
 /* ── Port enumeration ────────────────────────────────────────────────────────
-   cap_required: ALL these capability bits must be present.
-   cap_any:      OR accept if ANY of these bits match (catches DAW clock ports
-                 that expose CAP_READ but omit CAP_SUBS_READ).               */
+   Inputs:  any port with CAP_READ. Full subscribe ports qualify, and so do
+            plain READ-only ones (DAW clock sources that omit CAP_SUBS_READ).
+   Outputs: CAP_WRITE and CAP_SUBS_WRITE both present.                       */
+
+static uint32_t mm__alsa_port_flags(unsigned int cap) {
+    uint32_t flags = 0;
+    if (cap & SND_SEQ_PORT_CAP_READ) flags |= MM_PORT_INPUT;
+    if ((cap & (SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE))
+            == (SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE))
+        flags |= MM_PORT_OUTPUT;
+    return flags;
+}
 
-typedef struct { int client, port; char name[256]; } mm__alsa_pi;
-typedef struct { mm__alsa_pi ports[MM_MAX_PORTS]; uint32_t count; } mm__alsa_pl;
+static void mm__alsa_port_name(snd_seq_client_info_t* ci, snd_seq_port_info_t* pi,
+                               char* buf, size_t sz) {
+    snprintf(buf, sz, "%s:%s (%d:%d)",
+             snd_seq_client_info_get_name(ci), snd_seq_port_info_get_name(pi),
+             snd_seq_client_info_get_client(ci), snd_seq_port_info_get_port(pi));
+}
 
-static void mm__alsa_enum(mm_context* ctx, mm__alsa_pl* lst,
-                           unsigned int cap_req, unsigned int cap_any)
+/* Walk the ports carrying `want` in enumeration order and stop at the idx-th,
+   filling whichever of client/port/name were asked for. Returns how many
+   matching ports were seen: idx+1 if it was found, otherwise the total (so
+   idx = UINT32_MAX just counts). No list is built — nothing beyond the two
+   alloca'd info structs, and no upper bound on the number of ports.         */
+static uint32_t mm__alsa_walk(mm_context* ctx, uint32_t want, uint32_t idx,
+                              int* client, int* port, char* name, size_t namesz)
 {
-    mm__ctx_alsa* al = &ctx->al; lst->count = 0;
+    mm__ctx_alsa* al = &ctx->al;
+    uint32_t n = 0;
 
     /* snd_seq_client_info_alloca / snd_seq_port_info_alloca are stack-based
        macros in the ALSA headers — no malloc/free, no dlsym needed.         */
@@ -1057,276 +4284,866 @@ static void mm__alsa_enum(mm_context* ctx, mm__alsa_pl* lst,
         snd_seq_port_info_set_client(pi, cid);
         snd_seq_port_info_set_port(pi, -1);
         while (snd_seq_query_next_port(al->seq, pi) >= 0) {
-            unsigned int cap = snd_seq_port_info_get_capability(pi);
-            int ok = ((cap&cap_req)==cap_req) || (cap_any && (cap&cap_any));
-            if (!ok || lst->count >= MM_MAX_PORTS) continue;
-            mm__alsa_pi* p = &lst->ports[lst->count++];
-            p->client = cid;
-            p->port   = snd_seq_port_info_get_port(pi);
-            snprintf(p->name, sizeof(p->name), "%s:%s (%d:%d)",
-                     snd_seq_client_info_get_name(ci),
-                     snd_seq_port_info_get_name(pi), cid, p->port);
+            if (!(mm__alsa_port_flags(snd_seq_port_info_get_capability(pi)) & want))
+                continue;
+            if (n++ != idx) continue;
+            if (client) *client = cid;
+            if (port)   *port   = snd_seq_port_info_get_port(pi);
+            if (name)   mm__alsa_port_name(ci, pi, name, namesz);
+            return n;
         }
     }
+    return n;
 }
 
 uint32_t mm_in_count(mm_context* ctx) {
     if (!ctx||!ctx->initialized) return 0;
-    mm__alsa_pl lst;
-    /* Accept full subscribe ports OR plain READ-only (DAW clock sources) */
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
-        SND_SEQ_PORT_CAP_READ);
-    return lst.count;
+    return mm__alsa_walk(ctx, MM_PORT_INPUT, UINT32_MAX, NULL, NULL, NULL, 0);
 }
 uint32_t mm_out_count(mm_context* ctx) {
     if (!ctx||!ctx->initialized) return 0;
-    mm__alsa_pl lst;
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, 0);
-    return lst.count;
+    return mm__alsa_walk(ctx, MM_PORT_OUTPUT, UINT32_MAX, NULL, NULL, NULL, 0);
 }
 mm_result mm_in_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
-    if (!ctx||!ctx->initialized||!buf) return MM_INVALID_ARG;
-    mm__alsa_pl lst;
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
-        SND_SEQ_PORT_CAP_READ);
-    if (idx >= lst.count) return MM_OUT_OF_RANGE;
-    strncpy(buf, lst.ports[idx].name, sz-1); buf[sz-1]='\0'; return MM_SUCCESS;
+    if (!ctx||!ctx->initialized||!buf||!sz) return MM_INVALID_ARG;
+    if (mm__alsa_walk(ctx, MM_PORT_INPUT, idx, NULL, NULL, buf, sz) <= idx)
+        return MM_OUT_OF_RANGE;
+    return MM_SUCCESS;
 }
 mm_result mm_out_name(mm_context* ctx, uint32_t idx, char* buf, size_t sz) {
-    if (!ctx||!ctx->initialized||!buf) return MM_INVALID_ARG;
-    mm__alsa_pl lst;
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, 0);
-    if (idx >= lst.count) return MM_OUT_OF_RANGE;
-    strncpy(buf, lst.ports[idx].name, sz-1); buf[sz-1]='\0'; return MM_SUCCESS;
+    if (!ctx||!ctx->initialized||!buf||!sz) return MM_INVALID_ARG;
+    if (mm__alsa_walk(ctx, MM_PORT_OUTPUT, idx, NULL, NULL, buf, sz) <= idx)
+        return MM_OUT_OF_RANGE;
+    return MM_SUCCESS;
 }
 
-/* ── Receive thread — poll()-based, zero added latency ──────────────────────*/
+/* Registry: one pass over every client and port, classified with the same
+   rules as above, names interned into the registry's own storage.          */
+static mm_result mm__registry_enum(mm_port_registry* reg) {
+    mm__ctx_alsa* al = &reg->ctx->al;
+    snd_seq_client_info_t* ci;
+    snd_seq_port_info_t*   pi;
+    snd_seq_client_info_alloca(&ci);
+    snd_seq_port_info_alloca(&pi);
+    char name[256];
+
+    snd_seq_client_info_set_client(ci, -1);
+    while (snd_seq_query_next_client(al->seq, ci) >= 0) {
+        int cid = snd_seq_client_info_get_client(ci);
+        if (cid == al->client_id) continue;
+        snd_seq_port_info_set_client(pi, cid);
+        snd_seq_port_info_set_port(pi, -1);
+        while (snd_seq_query_next_port(al->seq, pi) >= 0) {
+            unsigned int cap = snd_seq_port_info_get_capability(pi);
+            uint32_t flags = mm__alsa_port_flags(cap);
+            if (!flags) continue;
+            mm__alsa_port_name(ci, pi, name, sizeof(name));
+            if (mm__registry_add(reg, name, cid, snd_seq_port_info_get_port(pi),
+                                 flags, cap, snd_seq_port_info_get_type(pi)) != MM_SUCCESS)
+                return MM_ALLOC_FAILED;
+        }
+    }
+    return MM_SUCCESS;
+}
 
-static void* mm__alsa_recv_thread(void* arg)
+/* Resolve an address spec to a port carrying the `want` MM_PORT_* flag.
+   "client:port" (numeric or client name) costs one targeted query; anything
+   else is a glob over the full port names, matched in a single enumeration
+   pass that stops at the first hit.                                         */
+static mm_result mm__alsa_resolve(mm_context* ctx, const char* spec, uint32_t want,
+                                  int* client, int* port)
 {
-    mm_device*    dev = (mm_device*)arg;
-    mm__ctx_alsa* al  = &dev->ctx->al;
-    mm__dev_alsa* da  = &dev->al;
+    mm__ctx_alsa* al = &ctx->al;
+    snd_seq_client_info_t* ci;
+    snd_seq_port_info_t*   pi;
+    snd_seq_client_info_alloca(&ci);
+    snd_seq_port_info_alloca(&pi);
 
-    /* Build pollfd set: ALSA fds + wakeup pipe read end */
-    int nalsa = snd_seq_poll_descriptors_count(al->seq, POLLIN);
-    if (nalsa < 0) nalsa = 0;
-    int nfds = nalsa + 1;
-    struct pollfd* pfds = (struct pollfd*)malloc((size_t)nfds * sizeof(struct pollfd));
-    if (!pfds) return NULL;
+    snd_seq_addr_t a;
+    if (snd_seq_parse_address(al->seq, &a, spec) >= 0 &&
+        a.client != al->client_id &&
+        snd_seq_get_any_port_info(al->seq, a.client, a.port, pi) >= 0 &&
+        (mm__alsa_port_flags(snd_seq_port_info_get_capability(pi)) & want)) {
+        *client = a.client; *port = a.port;
+        return MM_SUCCESS;
+    }
 
-    snd_seq_poll_descriptors(al->seq, pfds, (unsigned)nalsa, POLLIN);
-    pfds[nalsa].fd     = da->wake_pipe[0];
-    pfds[nalsa].events = POLLIN;
+    char name[256];
+    snd_seq_client_info_set_client(ci, -1);
+    while (snd_seq_query_next_client(al->seq, ci) >= 0) {
+        int cid = snd_seq_client_info_get_client(ci);
+        if (cid == al->client_id) continue;
+        snd_seq_port_info_set_client(pi, cid);
+        snd_seq_port_info_set_port(pi, -1);
+        while (snd_seq_query_next_port(al->seq, pi) >= 0) {
+            if (!(mm__alsa_port_flags(snd_seq_port_info_get_capability(pi)) & want))
+                continue;
+            mm__alsa_port_name(ci, pi, name, sizeof(name));
+            if (!mm__glob_match(spec, name)) continue;
+            *client = cid; *port = snd_seq_port_info_get_port(pi);
+            return MM_SUCCESS;
+        }
+    }
+    return MM_OUT_OF_RANGE;
+}
 
-    while (da->running) {
-        if (poll(pfds, (nfds_t)nfds, -1) < 0) break;
+/* ── Registry watch (System:Announce) ───────────────────────────────────────
+   The sequencer announces every client/port start, exit and change on port
+   0:1. Each announcement is applied to the registry in place: one targeted
+   query for the affected port, never a walk of the whole tree. The registry
+   stays sorted by client:port, i.e. in enumeration order, so indices keep
+   matching mm_in_* / mm_out_*.                                              */
+
+static void mm__alsa_watch_remove(mm_port_registry* reg, uint32_t pos) {
+    if (reg->watch_cb)
+        reg->watch_cb(reg, MM_PORT_REMOVED, &reg->ports[pos], reg->watch_userdata);
+    mm__registry_remove(reg, pos);
+    mm__registry_index(reg);
+}
 
-        /* Wakeup pipe: stop requested */
-        if (pfds[nalsa].revents & POLLIN) {
-            char c; (void)read(da->wake_pipe[0], &c, 1); break;
+/* Re-query one port and reconcile the registry with what the kernel says. */
+static void mm__alsa_watch_update(mm_port_registry* reg, int client, int port) {
+    mm__reg_alsa* w = &reg->al;
+    snd_seq_client_info_t* ci;
+    snd_seq_port_info_t*   pi;
+    snd_seq_client_info_alloca(&ci);
+    snd_seq_port_info_alloca(&pi);
+
+    uint32_t pos;
+    int      found = mm__registry_find(reg, client, port, &pos);
+    uint32_t flags = 0;
+    unsigned int cap = 0;
+    if (snd_seq_get_any_client_info(w->seq, client, ci) >= 0 &&
+        snd_seq_get_any_port_info(w->seq, client, port, pi) >= 0) {
+        cap   = snd_seq_port_info_get_capability(pi);
+        flags = mm__alsa_port_flags(cap);
+    }
+    if (!flags) {                       /* gone, or no longer usable by us */
+        if (found) mm__alsa_watch_remove(reg, pos);
+        return;
+    }
+
+    char name[256];
+    mm__alsa_port_name(ci, pi, name, sizeof(name));
+    uint32_t type = snd_seq_port_info_get_type(pi);
+    if (found) {
+        mm_port_info* e = &reg->ports[pos];
+        if (e->flags == flags && e->caps == cap && e->type == type &&
+            strcmp(e->name, name) == 0) return;
+        /* Update in place. The new name is interned first: if that fails
+           the entry keeps its old name rather than going missing.          */
+        const char* interned = e->name;
+        if (strcmp(e->name, name) != 0 &&
+            mm__registry_intern(reg, name, &interned) != MM_SUCCESS) {
+            reg->dropped++; return;
+        }
+        e->name  = interned;
+        e->flags = flags; e->caps = cap; e->type = type;
+        mm__registry_index(reg);   /* same count: never allocates */
+        if (reg->watch_cb)
+            reg->watch_cb(reg, MM_PORT_CHANGED, e, reg->watch_userdata);
+    } else {
+        if (mm__registry_insert(reg, pos, name, client, port, flags, cap, type) != MM_SUCCESS ||
+            mm__registry_index(reg) != MM_SUCCESS) {
+            reg->dropped++; return;
+        }
+        if (reg->watch_cb)
+            reg->watch_cb(reg, MM_PORT_ADDED, &reg->ports[pos], reg->watch_userdata);
+    }
+}
+
+static void mm__alsa_watch_event(mm_port_registry* reg, const snd_seq_event_t* ev) {
+    int client = ev->data.addr.client;
+    int port   = ev->data.addr.port;
+    if (client == reg->ctx->al.client_id || client == reg->al.client_id) return;
+    uint32_t pos;
+    switch (ev->type) {
+        case SND_SEQ_EVENT_PORT_START:
+        case SND_SEQ_EVENT_PORT_CHANGE:
+            mm__alsa_watch_update(reg, client, port);
+            break;
+        case SND_SEQ_EVENT_PORT_EXIT:
+            if (mm__registry_find(reg, client, port, &pos))
+                mm__alsa_watch_remove(reg, pos);
+            break;
+        case SND_SEQ_EVENT_CLIENT_EXIT:
+            /* Normally preceded by PORT_EXIT for each port; sweep any left. */
+            mm__registry_find(reg, client, 0, &pos);
+            while (pos < reg->count && reg->ports[pos].client == client)
+                mm__alsa_watch_remove(reg, pos);
+            break;
+        case SND_SEQ_EVENT_CLIENT_CHANGE: {
+            /* A client rename changes every port name of that client. Walk
+               by address, since each update may insert or remove entries.  */
+            int next = 0;
+            for (;;) {
+                mm__registry_find(reg, client, next, &pos);
+                if (pos >= reg->count || reg->ports[pos].client != client) break;
+                next = reg->ports[pos].port + 1;
+                mm__alsa_watch_update(reg, client, next - 1);
+            }
+            break;
         }
+        default: break;   /* CLIENT_START: its ports announce themselves */
+    }
+}
 
-        /* Drain all pending events from the kernel buffer.
-           Pass fetch_sequencer=1 to snd_seq_event_input_pending so it
-           actually queries the kernel — without this, virtual-port events
-           sit in the kernel ring and the pending count reads as 0.          */
-        while (snd_seq_event_input_pending(al->seq, 1) > 0) {
+static void* mm__alsa_watch_thread(void* arg)
+{
+    mm_port_registry* reg = (mm_port_registry*)arg;
+    mm__reg_alsa*     w   = &reg->al;
+    struct pollfd*    pfds  = w->pfds;
+    int               nfds  = w->nfds;
+    int               nalsa = nfds - 1;
+
+    for (;;) {
+        if (poll(pfds, (nfds_t)nfds, -1) < 0 && errno != EINTR) break;
+        if (pfds[nalsa].revents & POLLIN) {
+            char c; (void)read(w->wake_pipe[0], &c, 1); break;
+        }
+        while (snd_seq_event_input_pending(w->seq, 1) > 0) {
             snd_seq_event_t* ev = NULL;
-            int rc = snd_seq_event_input(al->seq, &ev);
-            if (rc == -EAGAIN || rc == -ENOSPC) break; /* nothing left */
+            int rc = snd_seq_event_input(w->seq, &ev);
             if (rc < 0 || !ev) break;
+            pthread_mutex_lock(&w->lock);
+            reg->fixed = 1;
+            mm__alsa_watch_event(reg, ev);
+            reg->fixed = 0;
+            pthread_mutex_unlock(&w->lock);
+        }
+    }
+    return NULL;
+}
 
-            mm_message msg; memset(&msg, 0, sizeof(msg));
-            struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
-            msg.timestamp = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
-
-            switch (ev->type) {
-                /* ── Channel messages ── */
-                case SND_SEQ_EVENT_NOTEON:
-                    msg.type    = (ev->data.note.velocity > 0) ? MM_NOTE_ON : MM_NOTE_OFF;
-                    msg.channel = ev->data.note.channel;
-                    msg.data[0] = ev->data.note.note;
-                    msg.data[1] = ev->data.note.velocity;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_NOTEOFF:
-                    msg.type=MM_NOTE_OFF; msg.channel=ev->data.note.channel;
-                    msg.data[0]=ev->data.note.note; msg.data[1]=ev->data.note.velocity;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_KEYPRESS:
-                    msg.type=MM_POLY_PRESSURE; msg.channel=ev->data.note.channel;
-                    msg.data[0]=ev->data.note.note; msg.data[1]=ev->data.note.velocity;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_CONTROLLER:
-                    msg.type=MM_CONTROL_CHANGE; msg.channel=ev->data.control.channel;
-                    msg.data[0]=(uint8_t)ev->data.control.param;
-                    msg.data[1]=(uint8_t)ev->data.control.value;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_PGMCHANGE:
-                    msg.type=MM_PROGRAM_CHANGE; msg.channel=ev->data.control.channel;
-                    msg.data[0]=(uint8_t)ev->data.control.value;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_CHANPRESS:
-                    msg.type=MM_CHANNEL_PRESSURE; msg.channel=ev->data.control.channel;
-                    msg.data[0]=(uint8_t)ev->data.control.value;
-                    dev->callback(dev, &msg, dev->userdata); break;
-
-                case SND_SEQ_EVENT_PITCHBEND: {
-                    int pb=ev->data.control.value+8192;
-                    msg.type=MM_PITCH_BEND; msg.channel=ev->data.control.channel;
-                    msg.data[0]=(uint8_t)(pb&0x7F); msg.data[1]=(uint8_t)((pb>>7)&0x7F);
-                    dev->callback(dev, &msg, dev->userdata); break;
-                }
+mm_result mm_registry_watch(mm_port_registry* reg, mm_port_callback cb, void* ud)
+{
+    if (!reg||!reg->ctx||!reg->ctx->initialized) return MM_INVALID_ARG;
+    if (reg->watching) return MM_ALREADY_OPEN;
+    mm__reg_alsa* w = &reg->al;
+
+    if (snd_seq_open(&w->seq, "default", SND_SEQ_OPEN_INPUT, 0) < 0) return MM_ERROR;
+    snd_seq_set_client_name(w->seq, reg->ctx->name);
+    w->client_id = snd_seq_client_id(w->seq);
+    /* NO_EXPORT and no SUBS_WRITE: invisible in everyone's port lists. */
+    w->port_id = snd_seq_create_simple_port(w->seq, "announce",
+        SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_NO_EXPORT,
+        SND_SEQ_PORT_TYPE_APPLICATION);
+    if (w->port_id < 0 ||
+        snd_seq_connect_from(w->seq, w->port_id, SND_SEQ_CLIENT_SYSTEM,
+                             SND_SEQ_PORT_SYSTEM_ANNOUNCE) < 0 ||
+        pipe(w->wake_pipe) != 0) {
+        snd_seq_close(w->seq); return MM_ERROR;
+    }
+    if (mm__alsa_pollfds(reg->ctx, w->seq, w->wake_pipe[0], &w->pfds, &w->nfds) != MM_SUCCESS) {
+        close(w->wake_pipe[0]); close(w->wake_pipe[1]);
+        snd_seq_close(w->seq); return MM_ALLOC_FAILED;
+    }
 
-                /* ── Transport & clock ── */
-                case SND_SEQ_EVENT_CLOCK:
-                    msg.type=MM_CLOCK; dev->callback(dev,&msg,dev->userdata); break;
-                case SND_SEQ_EVENT_START:
-                    msg.type=MM_START; dev->callback(dev,&msg,dev->userdata); break;
-                case SND_SEQ_EVENT_CONTINUE:
-                    msg.type=MM_CONTINUE; dev->callback(dev,&msg,dev->userdata); break;
-                case SND_SEQ_EVENT_STOP:
-                    msg.type=MM_STOP; dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── Song Position Pointer ── */
-                case SND_SEQ_EVENT_SONGPOS: {
-                    uint16_t pos=(uint16_t)ev->data.control.value;
-                    msg.type=MM_SONG_POSITION; msg.song_position=pos;
-                    msg.data[0]=(uint8_t)(pos&0x7F);
-                    msg.data[1]=(uint8_t)((pos>>7)&0x7F);
-                    dev->callback(dev,&msg,dev->userdata); break;
-                }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&w->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    /* Ports that appeared before the subscription took effect would never be
+       announced to us, so take one fresh snapshot now that we are listening. */
+    mm_registry_refresh(reg);
+    reg->watch_cb = cb; reg->watch_userdata = ud;
+    reg->watching = 1;
+    if (pthread_create(&w->thread, NULL, mm__alsa_watch_thread, reg) != 0) {
+        reg->watching = 0;
+        pthread_mutex_destroy(&w->lock);
+        mm__free(reg->ctx, w->pfds); w->pfds = NULL;
+        close(w->wake_pipe[0]); close(w->wake_pipe[1]);
+        snd_seq_close(w->seq); return MM_ERROR;
+    }
+    return MM_SUCCESS;
+}
 
-                /* ── MTC quarter frame ── */
-                case SND_SEQ_EVENT_QFRAME:
-                    msg.type=MM_MTC_QUARTER_FRAME;
-                    msg.data[0]=(uint8_t)ev->data.control.value;
-                    dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── Song Select ── */
-                case SND_SEQ_EVENT_SONGSEL:
-                    msg.type=MM_SONG_SELECT;
-                    msg.data[0]=(uint8_t)ev->data.control.value;
-                    dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── Active Sensing ── */
-                case SND_SEQ_EVENT_SENSING:
-                    msg.type=MM_ACTIVE_SENSE;
-                    dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── Tune Request ── */
-                case SND_SEQ_EVENT_TUNE_REQUEST:
-                    msg.type=MM_TUNE_REQUEST;
-                    dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── Reset ── */
-                case SND_SEQ_EVENT_RESET:
-                    msg.type=MM_RESET;
-                    dev->callback(dev,&msg,dev->userdata); break;
-
-                /* ── SysEx (may arrive in chunks) ── */
-                case SND_SEQ_EVENT_SYSEX: {
-                    uint8_t* d=(uint8_t*)ev->data.ext.ptr;
-                    size_t   n=ev->data.ext.len;
-                    if (da->sysex_pos+n < MM_SYSEX_BUF_SIZE) {
-                        memcpy(da->sysex_buf+da->sysex_pos, d, n);
-                        da->sysex_pos += n;
-                    }
-                    if (n > 0 && d[n-1] == 0xF7) {
-                        msg.type=MM_SYSEX; msg.sysex=da->sysex_buf;
-                        msg.sysex_size=da->sysex_pos;
-                        dev->callback(dev,&msg,dev->userdata);
-                        da->sysex_pos=0;
-                    }
-                    break;
+mm_result mm_registry_unwatch(mm_port_registry* reg)
+{
+    if (!reg||!reg->watching) return MM_NOT_OPEN;
+    mm__reg_alsa* w = &reg->al;
+    char c=1; (void)write(w->wake_pipe[1], &c, 1);
+    pthread_join(w->thread, NULL);
+    mm__free(reg->ctx, w->pfds); w->pfds = NULL;
+    close(w->wake_pipe[0]); close(w->wake_pipe[1]);
+    snd_seq_close(w->seq);   /* drops the port and its subscription */
+    pthread_mutex_destroy(&w->lock);
+    reg->watching = 0; reg->watch_cb = NULL; reg->watch_userdata = NULL;
+    return MM_SUCCESS;
+}
+
+void mm_registry_lock(mm_port_registry* reg) {
+    if (reg && reg->watching) pthread_mutex_lock(&reg->al.lock);
+}
+void mm_registry_unlock(mm_port_registry* reg) {
+    if (reg && reg->watching) pthread_mutex_unlock(&reg->al.lock);
+}
+
+/* ── Receive dispatcher — poll()-based, zero added latency ──────────────────
+   Every port we create lives on the context's sequencer handle, so a single
+   thread drains it and hands each event to the device that owns
+   ev->dest.port. It starts with the first mm_in_start and runs until
+   mm_context_uninit. Callbacks run with al->lock held: once mm_in_stop
+   returns, no callback for that device is in flight.                       */
+
+static mm_result mm__alsa_sysex_alloc(mm_context* ctx, mm__alsa_sysex** sxp) {
+    *sxp = (mm__alsa_sysex*)mm__calloc(ctx, 1, sizeof(mm__alsa_sysex) + ctx->config.sysex_size);
+    if (!*sxp) return MM_ALLOC_FAILED;
+    (*sxp)->buf = (uint8_t*)(*sxp + 1);
+    return MM_SUCCESS;
+}
+
+/* One reassembly buffer per port, made on the caller's thread at start so
+   the receive thread never allocates for SysEx (unless lazy_sysex).       */
+static mm_result mm__alsa_sysex_prepare(mm_device* dev) {
+    if (dev->ctx->config.lazy_sysex) return MM_SUCCESS;
+    const uint32_t n = dev->al.vports ? dev->al.vport_count : 1;
+    for (uint32_t i = 0; i < n; i++) {
+        mm__alsa_sysex** sxp = dev->al.vports ? &dev->al.vports[i].sysex : &dev->al.sysex;
+        if (!*sxp && mm__alsa_sysex_alloc(dev->ctx, sxp) != MM_SUCCESS) return MM_ALLOC_FAILED;
+    }
+    return MM_SUCCESS;
+}
+
+static void mm__alsa_deliver(mm_device* dev, uint16_t index, const snd_seq_event_t* ev)
+{
+    /* Sysex reassembly state is per port: chunks from different ports of a
+       multi-port device may interleave.                                    */
+    mm__alsa_sysex** sxp = dev->al.vports ? &dev->al.vports[index].sysex : &dev->al.sysex;
+    mm_message msg; memset(&msg, 0, sizeof(msg));
+    msg.port_index    = index;
+    msg.source_client = (int16_t)ev->source.client;
+    msg.source_port   = (int16_t)ev->source.port;
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    msg.timestamp = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+
+    switch (ev->type) {
+        /* ── Channel messages ── */
+        case SND_SEQ_EVENT_NOTEON:
+            msg.type    = (ev->data.note.velocity > 0) ? MM_NOTE_ON : MM_NOTE_OFF;
+            msg.channel = ev->data.note.channel & 0x0F;
+            msg.data[0] = ev->data.note.note & 0x7F;
+            msg.data[1] = ev->data.note.velocity & 0x7F;
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_NOTEOFF:
+            msg.type=MM_NOTE_OFF; msg.channel=ev->data.note.channel&0x0F;
+            msg.data[0]=ev->data.note.note&0x7F; msg.data[1]=ev->data.note.velocity&0x7F;
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_KEYPRESS:
+            msg.type=MM_POLY_PRESSURE; msg.channel=ev->data.note.channel&0x0F;
+            msg.data[0]=ev->data.note.note&0x7F; msg.data[1]=ev->data.note.velocity&0x7F;
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_CONTROLLER:
+            msg.type=MM_CONTROL_CHANGE; msg.channel=ev->data.control.channel&0x0F;
+            msg.data[0]=(uint8_t)(ev->data.control.param&0x7F);
+            msg.data[1]=(uint8_t)(ev->data.control.value&0x7F);
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_PGMCHANGE:
+            msg.type=MM_PROGRAM_CHANGE; msg.channel=ev->data.control.channel&0x0F;
+            msg.data[0]=(uint8_t)(ev->data.control.value&0x7F);
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_CHANPRESS:
+            msg.type=MM_CHANNEL_PRESSURE; msg.channel=ev->data.control.channel&0x0F;
+            msg.data[0]=(uint8_t)(ev->data.control.value&0x7F);
+            dev->callback(dev, &msg, dev->userdata); break;
+
+        case SND_SEQ_EVENT_PITCHBEND: {
+            unsigned pb=(unsigned)ev->data.control.value+8192u;
+            msg.type=MM_PITCH_BEND; msg.channel=ev->data.control.channel&0x0F;
+            msg.data[0]=(uint8_t)(pb&0x7F); msg.data[1]=(uint8_t)((pb>>7)&0x7F);
+            dev->callback(dev, &msg, dev->userdata); break;
+        }
+
+        /* ── Transport & clock ── */
+        case SND_SEQ_EVENT_CLOCK:
+            msg.type=MM_CLOCK; dev->callback(dev,&msg,dev->userdata); break;
+        case SND_SEQ_EVENT_START:
+            msg.type=MM_START; dev->callback(dev,&msg,dev->userdata); break;
+        case SND_SEQ_EVENT_CONTINUE:
+            msg.type=MM_CONTINUE; dev->callback(dev,&msg,dev->userdata); break;
+        case SND_SEQ_EVENT_STOP:
+            msg.type=MM_STOP; dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── Song Position Pointer ── */
+        case SND_SEQ_EVENT_SONGPOS: {
+            uint16_t pos=(uint16_t)(ev->data.control.value&0x3FFF);
+            msg.type=MM_SONG_POSITION; msg.song_position=pos;
+            msg.data[0]=(uint8_t)(pos&0x7F);
+            msg.data[1]=(uint8_t)((pos>>7)&0x7F);
+            dev->callback(dev,&msg,dev->userdata); break;
+        }
+
+        /* ── MTC quarter frame ── */
+        case SND_SEQ_EVENT_QFRAME:
+            msg.type=MM_MTC_QUARTER_FRAME;
+            msg.data[0]=(uint8_t)(ev->data.control.value&0x7F);
+            dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── Song Select ── */
+        case SND_SEQ_EVENT_SONGSEL:
+            msg.type=MM_SONG_SELECT;
+            msg.data[0]=(uint8_t)(ev->data.control.value&0x7F);
+            dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── Active Sensing ── */
+        case SND_SEQ_EVENT_SENSING:
+            msg.type=MM_ACTIVE_SENSE;
+            dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── Tune Request ── */
+        case SND_SEQ_EVENT_TUNE_REQUEST:
+            msg.type=MM_TUNE_REQUEST;
+            dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── Reset ── */
+        case SND_SEQ_EVENT_RESET:
+            msg.type=MM_RESET;
+            dev->callback(dev,&msg,dev->userdata); break;
+
+        /* ── SysEx (may arrive in chunks) ── */
+        case SND_SEQ_EVENT_SYSEX: {
+            const uint8_t* d=(const uint8_t*)ev->data.ext.ptr;
+            size_t   n=ev->data.ext.len;
+            if (!*sxp) {
+                /* Only with config.lazy_sysex; otherwise mm_in_start made it. */
+                if (!dev->ctx->config.lazy_sysex ||
+                    mm__alsa_sysex_alloc(dev->ctx, sxp) != MM_SUCCESS) break;
+            }
+            mm__alsa_sysex* sx = *sxp;
+            /* A different sender mid-message: drop the stale partial. */
+            if ((sx->pos || sx->dropping) && (sx->src.client != ev->source.client ||
+                                              sx->src.port   != ev->source.port))
+                sx->pos = 0, sx->dropping = 0;
+            sx->src = ev->source;
+            /* A chunk with no message to continue (its start was dropped)
+               is discarded. */
+            if (!sx->pos && !sx->dropping && (n == 0 || d[0] != 0xF0)) break;
+            if (sx->dropping || sx->pos+n > dev->ctx->config.sysex_size) {
+                sx->dropping = 1; sx->pos = 0;   /* never deliver it cut short */
+            } else {
+                memcpy(sx->buf+sx->pos, d, n);
+                sx->pos += n;
+            }
+            if (n > 0 && d[n-1] == 0xF7) {
+                if (!sx->dropping) {
+                    msg.type=MM_SYSEX; msg.sysex=sx->buf;
+                    msg.sysex_size=sx->pos;
+                    dev->callback(dev,&msg,dev->userdata);
                 }
-                default: break;
+                sx->pos=0; sx->dropping=0;
             }
+            break;
+        }
+        default: break;
+    }
+}
+
+#ifdef MM__ALSA_UMP
+/* UMP client input. A mm_ump_callback gets the packet as is; otherwise it
+   is decoded for the mm_callback, with per-port SysEx7 assembly like the
+   MIDI 1.0 path.                                                          */
+typedef struct mm__alsa_ump_sink {
+    mm_device*     dev;
+    uint16_t       index;
+    snd_seq_addr_t src;
+} mm__alsa_ump_sink;
+
+static void mm__alsa_ump_emit(const mm_message* m, void* ud) {
+    const mm__alsa_ump_sink* s = (const mm__alsa_ump_sink*)ud;
+    mm_message msg = *m;
+    msg.port_index    = s->index;
+    msg.source_client = (int16_t)s->src.client;
+    msg.source_port   = (int16_t)s->src.port;
+    s->dev->callback(s->dev, &msg, s->dev->userdata);
+}
+
+static void mm__alsa_deliver_ump(mm_device* dev, uint16_t index, const snd_seq_ump_event_t* ev)
+{
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    const double t = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+    const uint32_t* w = (const uint32_t*)ev->ump;
+    if (dev->ump_callback) {
+        dev->ump_callback(dev, w, mm_ump_words(w[0]), t, dev->ump_userdata);
+        return;
+    }
+    /* Allocated by mm_in_start (mm__alsa_ump_prepare), never here. */
+    mm_ump_decoder* d = dev->al.vports ? dev->al.vports[index].ump : dev->al.ump;
+    if (!d) return;
+    d->timestamp = t;
+    mm__alsa_ump_sink s = { dev, index, ev->source };
+    mm_ump_decode(d, w, mm_ump_words(w[0]), mm__alsa_ump_emit, &s);
+}
+
+/* One decoder per port, made on the caller's thread at start so the
+   receive thread never allocates for UMP input.                           */
+static mm_result mm__alsa_ump_prepare(mm_device* dev)
+{
+    const size_t cap = dev->ctx->config.sysex_size;
+    const uint32_t n = dev->al.vports ? dev->al.vport_count : 1;
+    for (uint32_t i = 0; i < n; i++) {
+        mm_ump_decoder** dp = dev->al.vports ? &dev->al.vports[i].ump : &dev->al.ump;
+        if (*dp) continue;
+        *dp = (mm_ump_decoder*)mm__calloc(dev->ctx, 1, sizeof(mm_ump_decoder) + cap);
+        if (!*dp) return MM_ALLOC_FAILED;
+        mm_ump_decoder_init(*dp, (uint8_t*)(*dp + 1), cap);
+    }
+    return MM_SUCCESS;
+}
+
+/* Non-UMP events (announcements, anything a legacy sender's event could
+   not be converted to) still arrive, in the legacy layout.                 */
+static uint32_t mm__alsa_drain_ump(mm__ctx_alsa* al)
+{
+    uint32_t n = 0;
+    while (snd_seq_event_input_pending(al->seq, 1) > 0) {
+        snd_seq_ump_event_t* ev = NULL;
+        int rc = snd_seq_ump_event_input(al->seq, &ev);
+        if (rc == -EAGAIN || rc == -ENOSPC) break;
+        if (rc < 0 || !ev) break;
+
+        pthread_mutex_lock(&al->lock);
+        const mm__alsa_slot* sl = &al->slots[ev->dest.port];
+        if (sl->dev) {
+            al->cb_thread = pthread_self(); al->in_callback = 1;
+            if (snd_seq_ev_is_ump(ev)) mm__alsa_deliver_ump(sl->dev, sl->index, ev);
+            else mm__alsa_deliver(sl->dev, sl->index, (const snd_seq_event_t*)ev);
+            al->in_callback = 0;
+            n++;
+        }
+        pthread_mutex_unlock(&al->lock);
+    }
+    return n;
+}
+#endif
+
+/* Drain all pending events from the kernel buffer and dispatch them.
+   Pass fetch_sequencer=1 to snd_seq_event_input_pending so it actually
+   queries the kernel — without this, virtual-port events sit in the
+   kernel ring and the pending count reads as 0.                            */
+static uint32_t mm__alsa_drain(mm__ctx_alsa* al)
+{
+    uint32_t n = 0;
+#ifdef MM__ALSA_UMP
+    if (al->ump) return mm__alsa_drain_ump(al);
+#endif
+    while (snd_seq_event_input_pending(al->seq, 1) > 0) {
+        snd_seq_event_t* ev = NULL;
+        int rc = snd_seq_event_input(al->seq, &ev);
+        if (rc == -EAGAIN || rc == -ENOSPC) break; /* nothing left */
+        if (rc < 0 || !ev) break;
+
+        pthread_mutex_lock(&al->lock);
+        const mm__alsa_slot* sl = &al->slots[ev->dest.port];
+        if (sl->dev) {
+            al->cb_thread = pthread_self(); al->in_callback = 1;
+            mm__alsa_deliver(sl->dev, sl->index, ev);
+            al->in_callback = 0;
+            n++;
         }
+        pthread_mutex_unlock(&al->lock);
     }
+    return n;
+}
+
+static void* mm__alsa_recv_thread(void* arg)
+{
+    mm_context*    ctx   = (mm_context*)arg;
+    mm__ctx_alsa*  al    = &ctx->al;
+    struct pollfd* pfds  = al->pfds;   /* ALSA fds + wakeup pipe read end */
+    int            nfds  = al->nfds;
+    int            nalsa = nfds - 1;
+
+    for (;;) {
+        if (poll(pfds, (nfds_t)nfds, -1) < 0) break;
 
-    free(pfds);
+        /* Wakeup pipe: context is going away */
+        if (pfds[nalsa].revents & POLLIN) {
+            char c; (void)read(al->wake_pipe[0], &c, 1); break;
+        }
+        mm__alsa_drain(al);
+    }
     return NULL;
 }
 
-mm_result mm_in_open(mm_context* ctx, mm_device* dev, uint32_t idx,
-                     mm_callback cb, void* ud)
+mm_result mm_context_dispatch(mm_context* ctx, int timeout_ms, uint32_t* dispatched)
 {
-    if (!ctx||!ctx->initialized||!dev||!cb) return MM_INVALID_ARG;
-    mm__alsa_pl lst;
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
-        SND_SEQ_PORT_CAP_READ);
-    if (idx >= lst.count) return MM_OUT_OF_RANGE;
+    if (dispatched) *dispatched = 0;
+    if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    if (ctx->config.delivery != MM_DELIVERY_POLL) return MM_INVALID_ARG;
+    mm__ctx_alsa* al = &ctx->al;
+    /* Events already read into alsa-lib's buffer don't show on the fds. */
+    if (snd_seq_event_input_pending(al->seq, 0) == 0 &&
+        poll(al->pfds, (nfds_t)(al->nfds - 1), timeout_ms) < 0 && errno != EINTR)
+        return MM_ERROR;
+    uint32_t n = mm__alsa_drain(al);
+    if (dispatched) *dispatched = n;
+    return MM_SUCCESS;
+}
+
+/* config.thread_priority > 0: ask for SCHED_FIFO at that priority. Without
+   the privilege pthread_create fails, and the caller retries with default
+   attributes — a slow thread beats no thread.                              */
+static int mm__alsa_spawn(mm_context* ctx)
+{
+    mm__ctx_alsa* al = &ctx->al;
+    if (ctx->config.thread_priority > 0) {
+        pthread_attr_t attr;
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = ctx->config.thread_priority;
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &sp);
+        int rc = pthread_create(&al->thread, &attr, mm__alsa_recv_thread, ctx);
+        pthread_attr_destroy(&attr);
+        if (rc == 0) return 0;
+    }
+    return pthread_create(&al->thread, NULL, mm__alsa_recv_thread, ctx);
+}
+
+/* Register dev with the dispatcher, starting the thread on first use
+   (MM_DELIVERY_THREAD only). Caller holds al->lock.                        */
+static mm_result mm__alsa_attach(mm_device* dev)
+{
+    mm__ctx_alsa* al = &dev->ctx->al;
+    if (!al->thread_running && dev->ctx->config.delivery == MM_DELIVERY_THREAD) {
+        if (pipe(al->wake_pipe) != 0) return MM_ERROR;
+        if (mm__alsa_pollfds(dev->ctx, al->seq, al->wake_pipe[0],
+                             &al->pfds, &al->nfds) != MM_SUCCESS) {
+            close(al->wake_pipe[0]); close(al->wake_pipe[1]); return MM_ALLOC_FAILED;
+        }
+        if (mm__alsa_spawn(dev->ctx) != 0) {
+            mm__free(dev->ctx, al->pfds); al->pfds = NULL;
+            close(al->wake_pipe[0]); close(al->wake_pipe[1]); return MM_ERROR;
+        }
+        al->thread_running = 1;
+    }
+    if (mm__alsa_sysex_prepare(dev) != MM_SUCCESS) return MM_ALLOC_FAILED;
+#ifdef MM__ALSA_UMP
+    if (al->ump && mm__alsa_ump_prepare(dev) != MM_SUCCESS) return MM_ALLOC_FAILED;
+#endif
+    if (dev->al.vports) {
+        for (uint32_t i = 0; i < dev->al.vport_count; i++) {
+            mm__alsa_slot* sl = &al->slots[dev->al.vports[i].port_id & 0xFF];
+            sl->dev = dev; sl->index = (uint16_t)i;
+        }
+    } else {
+        mm__alsa_slot* sl = &al->slots[dev->al.port_id & 0xFF];
+        sl->dev = dev; sl->index = 0;
+    }
+    dev->al.running = 1;
+    return MM_SUCCESS;
+}
 
+static mm_result mm__alsa_in_open_addr(mm_context* ctx, mm_device* dev,
+                                       int client, int port,
+                                       mm_callback cb, void* ud)
+{
     memset(dev,0,sizeof(*dev));
     dev->ctx=ctx; dev->callback=cb; dev->userdata=ud; dev->is_input=1;
-    dev->al.target_client = lst.ports[idx].client;
-    dev->al.target_port   = lst.ports[idx].port;
-
-    if (pipe(dev->al.wake_pipe) != 0) return MM_ERROR;
+    dev->al.target_client = client;
+    dev->al.target_port   = port;
 
     char portname[80]; snprintf(portname, sizeof(portname), "%s-in", ctx->name);
     dev->al.port_id = snd_seq_create_simple_port(ctx->al.seq, portname,
         SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE,
         SND_SEQ_PORT_TYPE_APPLICATION);
-    if (dev->al.port_id < 0) {
-        close(dev->al.wake_pipe[0]); close(dev->al.wake_pipe[1]); return MM_ERROR;
+    if (dev->al.port_id < 0) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+mm_result mm_in_open(mm_context* ctx, mm_device* dev, uint32_t idx,
+                     mm_callback cb, void* ud)
+{
+    if (!ctx||!ctx->initialized||!dev||!cb) return MM_INVALID_ARG;
+    int client = -1, port = -1;
+    if (mm__alsa_walk(ctx, MM_PORT_INPUT, idx, &client, &port, NULL, 0) <= idx)
+        return MM_OUT_OF_RANGE;
+    return mm__alsa_in_open_addr(ctx, dev, client, port, cb, ud);
+}
+
+mm_result mm_in_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port,
+                          mm_callback cb, void* ud)
+{
+    if (!ctx||!ctx->initialized||!dev||!cb||!port) return MM_INVALID_ARG;
+    if (!(port->flags & MM_PORT_INPUT)) return MM_INVALID_ARG;
+    return mm__alsa_in_open_addr(ctx, dev, port->client, port->port, cb, ud);
+}
+
+mm_result mm_in_open_by_address(mm_context* ctx, mm_device* dev, const char* spec,
+                                mm_callback cb, void* ud)
+{
+    if (!ctx||!ctx->initialized||!dev||!cb||!spec) return MM_INVALID_ARG;
+    int client = -1, port = -1;
+    mm_result res = mm__alsa_resolve(ctx, spec, MM_PORT_INPUT, &client, &port);
+    if (res != MM_SUCCESS) return res;
+    return mm__alsa_in_open_addr(ctx, dev, client, port, cb, ud);
+}
+
+mm_result mm_in_start(mm_device* dev) {
+    return mm_in_start_many(dev, 1);
+}
+
+mm_result mm_in_stop(mm_device* dev) {
+    return mm_in_stop_many(dev, 1);
+}
+
+double mm_in_time(const mm_device* dev) {
+    (void)dev;
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Per device: attach under the dispatch lock, then subscribe outside it,
+   so callbacks already running aren't held up by the subscribe calls.
+   The devices may belong to different contexts.                          */
+mm_result mm_in_start_many(mm_device* devs, uint32_t count) {
+    if (!devs) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_device* dev = &devs[i];
+        if (!dev->is_open||!dev->is_input) { res = MM_NOT_OPEN; continue; }
+        if (dev->al.running) continue;
+        mm__ctx_alsa* al = &dev->ctx->al;
+        pthread_mutex_lock(&al->lock);
+        mm_result r = mm__alsa_attach(dev);
+        pthread_mutex_unlock(&al->lock);
+        if (r != MM_SUCCESS) { res = r; continue; }
+        if (!dev->is_virtual)
+            snd_seq_connect_from(al->seq, dev->al.port_id,
+                                 dev->al.target_client, dev->al.target_port);
+    }
+    return res;
+}
+
+mm_result mm_in_stop_many(mm_device* devs, uint32_t count) {
+    if (!devs) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_device* dev = &devs[i];
+        if (!dev->is_open||!dev->is_input) { res = MM_NOT_OPEN; continue; }
+        if (!dev->al.running) continue;
+        mm__ctx_alsa* al = &dev->ctx->al;
+        if (mm__alsa_in_callback(al)) { res = MM_INVALID_ARG; continue; }
+        pthread_mutex_lock(&al->lock);
+        for (uint32_t p = 0; p < 256; p++)
+            if (al->slots[p].dev == dev) al->slots[p].dev = NULL;
+        dev->al.running = 0;
+        pthread_mutex_unlock(&al->lock);
+        if (!dev->is_virtual)
+            snd_seq_disconnect_from(al->seq, dev->al.port_id,
+                                    dev->al.target_client, dev->al.target_port);
+    }
+    return res;
+}
+
+mm_result mm_in_close(mm_device* dev) {
+    if (!dev||!dev->is_open) return MM_NOT_OPEN;
+    if (mm__alsa_in_callback(&dev->ctx->al)) return MM_INVALID_ARG;
+    if (dev->al.running) mm_in_stop(dev);
+    if (dev->al.vports) {
+        for (uint32_t i = 0; i < dev->al.vport_count; i++) {
+            snd_seq_delete_port(dev->ctx->al.seq, dev->al.vports[i].port_id);
+            mm__free(dev->ctx, dev->al.vports[i].sysex);
+            mm__free(dev->ctx, dev->al.vports[i].ump);
+        }
+        mm__free(dev->ctx, dev->al.vports); dev->al.vports = NULL;
+    } else
+        snd_seq_delete_port(dev->ctx->al.seq, dev->al.port_id);
+    mm__free(dev->ctx, dev->al.sysex); dev->al.sysex = NULL;
+    mm__free(dev->ctx, dev->al.ump);   dev->al.ump   = NULL;
+    dev->is_open=0; return MM_SUCCESS;
+}
+
+static mm_result mm__alsa_out_open_addr(mm_context* ctx, mm_device* dev,
+                                        int client, int port);
+
+/* ── Bulk open (ALSA) ──────────────────────────────────────────────────────
+   One walk resolves every requested index into devs[i].al.target_*; a
+   device whose index was not seen keeps target_client = -1.                */
+
+static void mm__alsa_walk_many(mm_context* ctx, uint32_t want, const uint32_t* idx,
+                               uint32_t count, mm_device* devs)
+{
+    mm__ctx_alsa* al = &ctx->al;
+    uint32_t n = 0, left = count;
+    for (uint32_t i = 0; i < count; i++) devs[i].al.target_client = -1;
+    if (!left) return;
+
+    snd_seq_client_info_t* ci;
+    snd_seq_port_info_t*   pi;
+    snd_seq_client_info_alloca(&ci);
+    snd_seq_port_info_alloca(&pi);
+
+    snd_seq_client_info_set_client(ci, -1);
+    while (snd_seq_query_next_client(al->seq, ci) >= 0) {
+        int cid = snd_seq_client_info_get_client(ci);
+        if (cid == al->client_id) continue;
+        snd_seq_port_info_set_client(pi, cid);
+        snd_seq_port_info_set_port(pi, -1);
+        while (snd_seq_query_next_port(al->seq, pi) >= 0) {
+            if (!(mm__alsa_port_flags(snd_seq_port_info_get_capability(pi)) & want))
+                continue;
+            for (uint32_t i = 0; i < count; i++) {
+                if (idx[i] != n) continue;
+                devs[i].al.target_client = cid;
+                devs[i].al.target_port   = snd_seq_port_info_get_port(pi);
+                left--;
+            }
+            n++;
+            if (!left) return;
+        }
     }
-    dev->is_open=1; return MM_SUCCESS;
 }
 
-mm_result mm_in_start(mm_device* dev) {
-    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
-    if (!dev->is_virtual) {
-        mm__ctx_alsa* al=&dev->ctx->al;
-        snd_seq_connect_from(al->seq, dev->al.port_id,
-                                  dev->al.target_client, dev->al.target_port);
+static mm_result mm__alsa_open_many(mm_context* ctx, mm_device* devs, uint32_t count,
+                                    int input, mm_callback cb, void* ud,
+                                    mm_result* results)
+{
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_device* dev = &devs[i];
+        int client = dev->al.target_client, port = dev->al.target_port;
+        mm_result r;
+        if (client < 0)  { memset(dev, 0, sizeof(*dev)); r = MM_OUT_OF_RANGE; }
+        else if (input)  r = mm__alsa_in_open_addr(ctx, dev, client, port, cb, ud);
+        else             r = mm__alsa_out_open_addr(ctx, dev, client, port);
+        if (results) results[i] = r;
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
     }
-    dev->al.running=1;
-    pthread_create(&dev->al.thread, NULL, mm__alsa_recv_thread, dev);
-    return MM_SUCCESS;
+    return res;
 }
 
-mm_result mm_in_stop(mm_device* dev) {
-    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
-    dev->al.running=0;
-    char c=1; (void)write(dev->al.wake_pipe[1], &c, 1); /* wake the poll() */
-    pthread_join(dev->al.thread, NULL);
-    if (!dev->is_virtual) {
-        mm__ctx_alsa* al=&dev->ctx->al;
-        snd_seq_disconnect_from(al->seq, dev->al.port_id,
-                                     dev->al.target_client, dev->al.target_port);
-    }
-    return MM_SUCCESS;
+mm_result mm_in_open_many(mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                          uint32_t count, mm_callback cb, void* ud, mm_result* results)
+{
+    if (!ctx||!ctx->initialized||!devs||!idx||!cb) return MM_INVALID_ARG;
+    mm__alsa_walk_many(ctx, MM_PORT_INPUT, idx, count, devs);
+    return mm__alsa_open_many(ctx, devs, count, 1, cb, ud, results);
 }
 
-mm_result mm_in_close(mm_device* dev) {
-    if (!dev||!dev->is_open) return MM_NOT_OPEN;
-    if (dev->al.running) mm_in_stop(dev);
-    close(dev->al.wake_pipe[0]); close(dev->al.wake_pipe[1]);
-    snd_seq_delete_port(dev->ctx->al.seq, dev->al.port_id);
-    dev->is_open=0; return MM_SUCCESS;
+mm_result mm_out_open_many(mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                           uint32_t count, mm_result* results)
+{
+    if (!ctx||!ctx->initialized||!devs||!idx) return MM_INVALID_ARG;
+    mm__alsa_walk_many(ctx, MM_PORT_OUTPUT, idx, count, devs);
+    return mm__alsa_open_many(ctx, devs, count, 0, NULL, NULL, results);
 }
 
-mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
-    if (!ctx||!ctx->initialized||!dev) return MM_INVALID_ARG;
-    mm__alsa_pl lst;
-    mm__alsa_enum(ctx, &lst,
-        SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE, 0);
-    if (idx >= lst.count) return MM_OUT_OF_RANGE;
+static mm_result mm__alsa_out_open_addr(mm_context* ctx, mm_device* dev,
+                                        int client, int port)
+{
     memset(dev,0,sizeof(*dev)); dev->ctx=ctx; dev->is_input=0;
-    dev->al.target_client=lst.ports[idx].client;
-    dev->al.target_port  =lst.ports[idx].port;
+    dev->al.target_client=client;
+    dev->al.target_port  =port;
     char portname[80]; snprintf(portname, sizeof(portname), "%s-out", ctx->name);
     dev->al.port_id=snd_seq_create_simple_port(ctx->al.seq, portname,
         SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
@@ -1337,8 +5154,41 @@ mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
     dev->is_open=1; return MM_SUCCESS;
 }
 
+mm_result mm_out_open(mm_context* ctx, mm_device* dev, uint32_t idx) {
+    if (!ctx||!ctx->initialized||!dev) return MM_INVALID_ARG;
+    int client = -1, port = -1;
+    if (mm__alsa_walk(ctx, MM_PORT_OUTPUT, idx, &client, &port, NULL, 0) <= idx)
+        return MM_OUT_OF_RANGE;
+    return mm__alsa_out_open_addr(ctx, dev, client, port);
+}
+
+mm_result mm_out_open_port(mm_context* ctx, mm_device* dev, const mm_port_info* port) {
+    if (!ctx||!ctx->initialized||!dev||!port) return MM_INVALID_ARG;
+    if (!(port->flags & MM_PORT_OUTPUT)) return MM_INVALID_ARG;
+    return mm__alsa_out_open_addr(ctx, dev, port->client, port->port);
+}
+
+mm_result mm_out_open_by_address(mm_context* ctx, mm_device* dev, const char* spec) {
+    if (!ctx||!ctx->initialized||!dev||!spec) return MM_INVALID_ARG;
+    int client = -1, port = -1;
+    mm_result res = mm__alsa_resolve(ctx, spec, MM_PORT_OUTPUT, &client, &port);
+    if (res != MM_SUCCESS) return res;
+    return mm__alsa_out_open_addr(ctx, dev, client, port);
+}
+
 /* snd_seq_ev_set_* are inline static functions/macros in the ALSA headers.
    We call them directly — no dlsym needed.                                  */
+/* The context's queue, started on first use; -1 if none can be had. */
+static int mm__alsa_ctx_queue(mm__ctx_alsa* al, const char* name) {
+    if (al->queue < 0) {
+        al->queue = snd_seq_alloc_named_queue(al->seq, name);
+        if (al->queue < 0) return -1;
+        snd_seq_start_queue(al->seq, al->queue, NULL);
+        snd_seq_drain_output(al->seq);
+    }
+    return al->queue;
+}
+
 static void mm__alsa_send_ev(mm_device* dev, snd_seq_event_t* ev) {
     mm__ctx_alsa* al=&dev->ctx->al;
     snd_seq_ev_set_direct(ev);
@@ -1348,52 +5198,113 @@ static void mm__alsa_send_ev(mm_device* dev, snd_seq_event_t* ev) {
     snd_seq_drain_output(al->seq);
 }
 
-mm_result mm_out_send(mm_device* dev, const mm_message* msg) {
-    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
-    if (!msg) return MM_INVALID_ARG;
-    snd_seq_event_t ev; memset(&ev,0,sizeof(ev));
+#ifdef MM__ALSA_UMP
+/* UMP client output: one sequencer event per packet. */
+static mm_result mm__alsa_send_ump(mm_device* dev, const uint32_t* words, size_t n) {
+    mm__ctx_alsa* al = &dev->ctx->al;
+    size_t i = 0;
+    while (i < n) i += mm_ump_words(words[i]);
+    if (i != n) return MM_INVALID_ARG;
+    for (i = 0; i < n; ) {
+        uint32_t len = mm_ump_words(words[i]);
+        snd_seq_ump_event_t ev; memset(&ev, 0, sizeof(ev));
+        ev.flags = SND_SEQ_EVENT_UMP;
+        memcpy(ev.ump, words + i, len * sizeof(uint32_t));
+        snd_seq_ev_set_direct(&ev);
+        snd_seq_ev_set_source(&ev, dev->al.port_id);
+        snd_seq_ev_set_subs(&ev);
+        if (snd_seq_ump_event_output(al->seq, &ev) < 0) return MM_ERROR;
+        i += len;
+    }
+    snd_seq_drain_output(al->seq);
+    return MM_SUCCESS;
+}
+#endif
+
+/* mm_message_type → sequencer event type, the ALSA twin of mm__type_table. */
+static const unsigned char mm__alsa_ev_type[32] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    SND_SEQ_EVENT_NOTEOFF,    SND_SEQ_EVENT_NOTEON,    SND_SEQ_EVENT_KEYPRESS,
+    SND_SEQ_EVENT_CONTROLLER, SND_SEQ_EVENT_PGMCHANGE, SND_SEQ_EVENT_CHANPRESS,
+    SND_SEQ_EVENT_PITCHBEND,  0,
+    0, SND_SEQ_EVENT_QFRAME, SND_SEQ_EVENT_SONGPOS, SND_SEQ_EVENT_SONGSEL,
+    SND_SEQ_EVENT_TUNE_REQUEST, 0, 0, 0,
+    SND_SEQ_EVENT_CLOCK, 0, SND_SEQ_EVENT_START, SND_SEQ_EVENT_CONTINUE,
+    SND_SEQ_EVENT_STOP,  0, SND_SEQ_EVENT_SENSING, SND_SEQ_EVENT_RESET,
+};
+
+/* Validate and normalise through the shared encoder, then fill the event
+   from the wire bytes; only the union member varies by type. 0 = invalid. */
+static int mm__alsa_message_ev(const mm_message* msg, snd_seq_event_t* ev) {
+    uint8_t raw[3];
+    if (!mm__encode(msg, raw)) return 0;
+    memset(ev,0,sizeof(*ev));
+    ev->type = mm__alsa_ev_type[msg->type];
     switch (msg->type) {
-        case MM_NOTE_ON:
-            snd_seq_ev_set_noteon(&ev,msg->channel,msg->data[0],msg->data[1]); break;
-        case MM_NOTE_OFF:
-            snd_seq_ev_set_noteoff(&ev,msg->channel,msg->data[0],msg->data[1]); break;
+        case MM_NOTE_OFF: case MM_NOTE_ON: case MM_POLY_PRESSURE:
+            ev->data.note.channel  = raw[0] & 0x0F;
+            ev->data.note.note     = raw[1];
+            ev->data.note.velocity = raw[2]; break;
         case MM_CONTROL_CHANGE:
-            snd_seq_ev_set_controller(&ev,msg->channel,msg->data[0],msg->data[1]); break;
-        case MM_PITCH_BEND: {
-            int pb=((int)msg->data[1]<<7)|msg->data[0];
-            snd_seq_ev_set_pitchbend(&ev,msg->channel,pb-8192); break;
-        }
-        case MM_PROGRAM_CHANGE:
-            snd_seq_ev_set_pgmchange(&ev,msg->channel,msg->data[0]); break;
-        case MM_CLOCK:    ev.type=SND_SEQ_EVENT_CLOCK;    break;
-        case MM_START:    ev.type=SND_SEQ_EVENT_START;    break;
-        case MM_CONTINUE: ev.type=SND_SEQ_EVENT_CONTINUE; break;
-        case MM_STOP:     ev.type=SND_SEQ_EVENT_STOP;     break;
+            ev->data.control.channel = raw[0] & 0x0F;
+            ev->data.control.param   = raw[1];
+            ev->data.control.value   = raw[2]; break;
+        case MM_PROGRAM_CHANGE: case MM_CHANNEL_PRESSURE:
+            ev->data.control.channel = raw[0] & 0x0F;
+            ev->data.control.value   = raw[1]; break;
+        case MM_PITCH_BEND:
+            ev->data.control.channel = raw[0] & 0x0F;
+            ev->data.control.value   = (raw[1] | (raw[2] << 7)) - 8192; break;
         case MM_SONG_POSITION:
-            ev.type=SND_SEQ_EVENT_SONGPOS;
-            ev.data.control.value=msg->song_position; break;
-        case MM_MTC_QUARTER_FRAME:
-            ev.type=SND_SEQ_EVENT_QFRAME;
-            ev.data.control.value=msg->data[0]; break;
-        case MM_SONG_SELECT:
-            ev.type=SND_SEQ_EVENT_SONGSEL;
-            ev.data.control.value=msg->data[0]; break;
-        case MM_TUNE_REQUEST:  ev.type=SND_SEQ_EVENT_TUNE_REQUEST; break;
-        case MM_ACTIVE_SENSE:  ev.type=SND_SEQ_EVENT_SENSING;      break;
-        case MM_RESET:         ev.type=SND_SEQ_EVENT_RESET;        break;
-        default: return MM_INVALID_ARG;
+            ev->data.control.value   = raw[1] | (raw[2] << 7); break;
+        case MM_MTC_QUARTER_FRAME: case MM_SONG_SELECT:
+            ev->data.control.value   = raw[1]; break;
+        default: break;   /* real-time, tune request: no payload */
     }
+    return 1;
+}
+
+mm_result mm_out_send(mm_device* dev, const mm_message* msg) {
+    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
+    if (!msg) return MM_INVALID_ARG;
+    snd_seq_event_t ev;
+    if (!mm__alsa_message_ev(msg, &ev)) return MM_INVALID_ARG;
     mm__alsa_send_ev(dev,&ev); return MM_SUCCESS;
 }
 
+/* Scheduled relative to the queue's time on arrival, so the queue needs
+   no mapping to CLOCK_MONOTONIC and each event is as exact as the last
+   mm_in_time: no drift builds up across calls.                            */
+mm_result mm_out_send_at(mm_device* dev, const mm_message* msg, double time) {
+    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
+    if (!msg) return MM_INVALID_ARG;
+    snd_seq_event_t ev;
+    if (!mm__alsa_message_ev(msg, &ev)) return MM_INVALID_ARG;
+    const double delay = time - mm_in_time(dev);
+    if (!(delay > 0.0)) { mm__alsa_send_ev(dev,&ev); return MM_SUCCESS; }
+    mm__ctx_alsa* al = &dev->ctx->al;
+    const int q = mm__alsa_ctx_queue(al, dev->ctx->name);
+    if (q < 0) return MM_ERROR;
+    snd_seq_real_time_t rt;
+    rt.tv_sec  = (unsigned int)delay;
+    rt.tv_nsec = (unsigned int)((delay - (double)rt.tv_sec) * 1e9);
+    snd_seq_ev_schedule_real(&ev, q, 1, &rt);
+    snd_seq_ev_set_source(&ev, dev->al.port_id);
+    snd_seq_ev_set_subs(&ev);
+    if (snd_seq_event_output(al->seq, &ev) < 0) return MM_ERROR;
+    snd_seq_drain_output(al->seq);
+    return MM_SUCCESS;
+}
+
 mm_result mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size) {
     if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
-    if (!data||!size||size>MM_SYSEX_BUF_SIZE) return MM_INVALID_ARG;
-    memcpy(dev->al.sysex_buf, data, size);
+    if (!data||!size||size>dev->ctx->config.sysex_size) return MM_INVALID_ARG;
+    /* snd_seq_event_output copies variable-length data into the output
+       buffer, so the caller's bytes are sent in place.                     */
     snd_seq_event_t ev; memset(&ev,0,sizeof(ev));
     ev.type=SND_SEQ_EVENT_SYSEX;
     ev.data.ext.len=(unsigned int)size;
-    ev.data.ext.ptr=dev->al.sysex_buf;
+    ev.data.ext.ptr=(void*)data;
     ev.flags=SND_SEQ_EVENT_LENGTH_VARIABLE;
     mm__alsa_send_ev(dev,&ev); return MM_SUCCESS;
 }
@@ -1401,13 +5312,312 @@ mm_result mm_out_send_sysex(mm_device* dev, const uint8_t* data, size_t size) {
 mm_result mm_out_close(mm_device* dev) {
     if (!dev||!dev->is_open) return MM_NOT_OPEN;
     mm__ctx_alsa* al=&dev->ctx->al;
-    if (!dev->is_virtual)
+    if (dev->is_group) {
+        for (uint32_t i = 0; i < dev->al.member_count; i++)
+            snd_seq_disconnect_to(al->seq, dev->al.port_id,
+                                  dev->al.members[i].client, dev->al.members[i].port);
+        mm__free(dev->ctx, dev->al.members); dev->al.members = NULL;
+        dev->al.member_count = dev->al.member_cap = 0;
+    } else if (!dev->is_virtual)
         snd_seq_disconnect_to(al->seq,dev->al.port_id,
                                    dev->al.target_client,dev->al.target_port);
     snd_seq_delete_port(al->seq,dev->al.port_id);
+    mm__ump_release(dev);
     dev->is_open=0; return MM_SUCCESS;
 }
 
+/* ── Clock master (ALSA) ───────────────────────────────────────────────────
+   The queue runs from init at 24 PPQ, so a clock's tick is its number and
+   a tempo event retimes every clock after it. Our events carry a tag, so
+   a stop can withdraw just the clocks still in the queue. Events for the
+   same tick leave in the order they were queued.                          */
+#define MM__CLOCK_TAG 0x4D
+
+static unsigned mm__clock_tempo_us(double bpm) { return (unsigned)(60e6 / bpm + 0.5); }
+
+static uint32_t mm__clock_now(const mm_clock_master* m) {
+    snd_seq_queue_status_t* st; snd_seq_queue_status_alloca(&st);
+    if (snd_seq_get_queue_status(m->dev->ctx->al.seq, m->queue, st) < 0) return 0;
+    return (uint32_t)snd_seq_queue_status_get_tick_time(st);
+}
+
+static int mm__clock_put(mm_clock_master* m, int type, uint32_t tick, int value) {
+    snd_seq_event_t ev; snd_seq_ev_clear(&ev);
+    ev.type = (snd_seq_event_type_t)type;
+    ev.tag  = MM__CLOCK_TAG;
+    ev.data.control.value = value;
+    snd_seq_ev_schedule_tick(&ev, m->queue, 0, tick);
+    snd_seq_ev_set_source(&ev, m->dev->al.port_id);
+    snd_seq_ev_set_subs(&ev);
+    return snd_seq_event_output(m->dev->ctx->al.seq, &ev);
+}
+
+/* Scheduled events keep the subscribers address until they are played,
+   which with the queue and tag picks out exactly ours.                    */
+static void mm__clock_withdraw(mm_clock_master* m) {
+    snd_seq_remove_events_t* rm; snd_seq_remove_events_alloca(&rm);
+    snd_seq_addr_t subs;
+    subs.client = SND_SEQ_ADDRESS_SUBSCRIBERS;
+    subs.port   = SND_SEQ_ADDRESS_UNKNOWN;
+    snd_seq_remove_events_set_condition(rm, SND_SEQ_REMOVE_OUTPUT | SND_SEQ_REMOVE_DEST |
+                                            SND_SEQ_REMOVE_TAG_MATCH);
+    snd_seq_remove_events_set_queue(rm, m->queue);
+    snd_seq_remove_events_set_dest(rm, &subs);
+    snd_seq_remove_events_set_tag(rm, MM__CLOCK_TAG);
+    snd_seq_remove_events(m->dev->ctx->al.seq, rm);
+}
+
+mm_result mm_clock_master_init(mm_clock_master* m, mm_device* out, double bpm) {
+    if (!m) return MM_INVALID_ARG;
+    memset(m, 0, sizeof(*m));
+    m->queue = -1;
+    if (!out||!out->is_open||out->is_input) return MM_NOT_OPEN;
+    if (!(bpm >= 10.0 && bpm <= 1000.0)) return MM_INVALID_ARG;
+    snd_seq_t* seq = out->ctx->al.seq;
+    int q = snd_seq_alloc_named_queue(seq, out->ctx->name);
+    if (q < 0) return MM_ERROR;
+    snd_seq_queue_tempo_t* qt; snd_seq_queue_tempo_alloca(&qt);
+    snd_seq_queue_tempo_set_tempo(qt, mm__clock_tempo_us(bpm));
+    snd_seq_queue_tempo_set_ppq(qt, 24);
+    if (snd_seq_set_queue_tempo(seq, q, qt) < 0) { snd_seq_free_queue(seq, q); return MM_ERROR; }
+    snd_seq_start_queue(seq, q, NULL);
+    snd_seq_drain_output(seq);
+    m->dev = out; m->bpm = bpm; m->window = 48; m->queue = q;
+    return MM_SUCCESS;
+}
+
+mm_result mm_clock_master_uninit(mm_clock_master* m) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    mm_clock_master_stop(m);
+    snd_seq_t* seq = m->dev->ctx->al.seq;
+    snd_seq_stop_queue(seq, m->queue, NULL);
+    snd_seq_drain_output(seq);
+    snd_seq_free_queue(seq, m->queue);
+    m->queue = -1;
+    return MM_SUCCESS;
+}
+
+mm_result mm_clock_master_refill(mm_clock_master* m) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (!m->running) return MM_SUCCESS;
+    const uint32_t now = mm__clock_now(m);
+    /* Fell behind the queue? Sending the missed clocks now would be a
+       burst at many times the tempo; pick up on the next tick instead.
+       song_clock counts clocks sent, so it still matches the slaves'.    */
+    if ((int32_t)(now + 1 - m->next_tick) > 0) m->next_tick = now + 1;
+    const uint32_t until = now + m->window;
+    int err = 0;
+    while ((int32_t)(until - m->next_tick) > 0) {
+        if ((err = mm__clock_put(m, SND_SEQ_EVENT_CLOCK, m->next_tick, 0)) < 0) break;
+        m->next_tick++; m->song_clock++;
+    }
+    snd_seq_drain_output(m->dev->ctx->al.seq);
+    return err < 0 ? MM_ERROR : MM_SUCCESS;
+}
+
+/* Transport message on the next clock, the first clock one after it. */
+static mm_result mm__clock_play(mm_clock_master* m, int type) {
+    const uint32_t t = mm__clock_now(m) + 1;
+    if (mm__clock_put(m, type, t, 0) < 0) return MM_ERROR;
+    m->next_tick = t + 1;
+    m->running   = 1;
+    return mm_clock_master_refill(m);
+}
+
+mm_result mm_clock_master_start(mm_clock_master* m) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (m->running) mm__clock_withdraw(m);
+    m->song_clock = 0;
+    return mm__clock_play(m, SND_SEQ_EVENT_START);
+}
+
+mm_result mm_clock_master_continue(mm_clock_master* m) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (m->running) return MM_SUCCESS;
+    return mm__clock_play(m, SND_SEQ_EVENT_CONTINUE);
+}
+
+mm_result mm_clock_master_stop(mm_clock_master* m) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (!m->running) return MM_SUCCESS;
+    mm__clock_withdraw(m);
+    /* Clocks up to the current tick were played; the rest are gone. */
+    const uint32_t played_until = mm__clock_now(m) + 1;
+    if ((int32_t)(m->next_tick - played_until) > 0)
+        m->song_clock -= m->next_tick - played_until;
+    m->running = 0;
+    snd_seq_event_t ev; snd_seq_ev_clear(&ev);
+    ev.type = SND_SEQ_EVENT_STOP;
+    mm__alsa_send_ev(m->dev, &ev);
+    return MM_SUCCESS;
+}
+
+mm_result mm_clock_master_locate(mm_clock_master* m, uint16_t song_position) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (song_position > 0x3FFF) return MM_INVALID_ARG;
+    if (!m->running) {
+        snd_seq_event_t ev; snd_seq_ev_clear(&ev);
+        ev.type = SND_SEQ_EVENT_SONGPOS;
+        ev.data.control.value = song_position;
+        mm__alsa_send_ev(m->dev, &ev);
+        m->song_clock = (uint32_t)song_position * 6u;
+        return MM_SUCCESS;
+    }
+    mm__clock_withdraw(m);
+    const uint32_t t = mm__clock_now(m) + 1;
+    if (mm__clock_put(m, SND_SEQ_EVENT_STOP,    t, 0) < 0 ||
+        mm__clock_put(m, SND_SEQ_EVENT_SONGPOS, t, song_position) < 0) return MM_ERROR;
+    m->song_clock = (uint32_t)song_position * 6u;
+    return mm__clock_play(m, SND_SEQ_EVENT_CONTINUE);
+}
+
+mm_result mm_clock_master_set_tempo(mm_clock_master* m, double bpm) {
+    if (!m||m->queue < 0) return MM_NOT_OPEN;
+    if (!(bpm >= 10.0 && bpm <= 1000.0)) return MM_INVALID_ARG;
+    /* On the next clock, so no clock interval is part old, part new. */
+    snd_seq_event_t ev; snd_seq_ev_clear(&ev);
+    snd_seq_ev_schedule_tick(&ev, m->queue, 0, mm__clock_now(m) + 1);
+    snd_seq_ev_set_source(&ev, m->dev->al.port_id);
+    if (snd_seq_change_queue_tempo(m->dev->ctx->al.seq, m->queue,
+                                   (int)mm__clock_tempo_us(bpm), &ev) < 0) return MM_ERROR;
+    snd_seq_drain_output(m->dev->ctx->al.seq);
+    m->bpm = bpm;
+    return MM_SUCCESS;
+}
+
+/* ── Output groups (ALSA) ──────────────────────────────────────────────────
+   A group is a single source port with one subscription per member.
+   mm__alsa_send_ev already addresses SND_SEQ_ADDRESS_SUBSCRIBERS, so the
+   kernel copies each event to every member: one event, one drain, any width. */
+
+mm_result mm_out_open_group(mm_context* ctx, mm_device* dev) {
+    if (!ctx||!ctx->initialized||!dev) return MM_INVALID_ARG;
+    memset(dev,0,sizeof(*dev)); dev->ctx=ctx; dev->is_input=0; dev->is_group=1;
+    char portname[80]; snprintf(portname, sizeof(portname), "%s-out", ctx->name);
+    dev->al.port_id=snd_seq_create_simple_port(ctx->al.seq, portname,
+        SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
+        SND_SEQ_PORT_TYPE_APPLICATION);
+    if (dev->al.port_id < 0) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+static mm_result mm__alsa_out_addr(mm_context* ctx, uint32_t idx, snd_seq_addr_t* a) {
+    int client = -1, port = -1;
+    if (mm__alsa_walk(ctx, MM_PORT_OUTPUT, idx, &client, &port, NULL, 0) <= idx)
+        return MM_OUT_OF_RANGE;
+    a->client = (unsigned char)client;
+    a->port   = (unsigned char)port;
+    return MM_SUCCESS;
+}
+
+mm_result mm_out_group_add(mm_device* dev, uint32_t out_idx) {
+    if (!dev||!dev->is_open||!dev->is_group) return MM_NOT_OPEN;
+    mm__dev_alsa* da = &dev->al;
+    snd_seq_addr_t a;
+    mm_result res = mm__alsa_out_addr(dev->ctx, out_idx, &a);
+    if (res != MM_SUCCESS) return res;
+    for (uint32_t i = 0; i < da->member_count; i++)
+        if (da->members[i].client == a.client && da->members[i].port == a.port)
+            return MM_ALREADY_OPEN;
+    if (da->member_count == da->member_cap) {
+        uint32_t cap = da->member_cap ? da->member_cap * 2 : 8;
+        snd_seq_addr_t* m = (snd_seq_addr_t*)mm__realloc(dev->ctx, da->members, cap * sizeof(*m));
+        if (!m) return MM_ALLOC_FAILED;
+        da->members = m; da->member_cap = cap;
+    }
+    if (snd_seq_connect_to(dev->ctx->al.seq, da->port_id, a.client, a.port) < 0)
+        return MM_ERROR;
+    da->members[da->member_count++] = a;
+    return MM_SUCCESS;
+}
+
+mm_result mm_out_group_remove(mm_device* dev, uint32_t out_idx) {
+    if (!dev||!dev->is_open||!dev->is_group) return MM_NOT_OPEN;
+    mm__dev_alsa* da = &dev->al;
+    snd_seq_addr_t a;
+    mm_result res = mm__alsa_out_addr(dev->ctx, out_idx, &a);
+    if (res != MM_SUCCESS) return res;
+    for (uint32_t i = 0; i < da->member_count; i++) {
+        if (da->members[i].client != a.client || da->members[i].port != a.port) continue;
+        snd_seq_disconnect_to(dev->ctx->al.seq, da->port_id, a.client, a.port);
+        da->members[i] = da->members[--da->member_count];
+        return MM_SUCCESS;
+    }
+    return MM_NOT_OPEN;
+}
+
+/* ── Kernel-level routing (ALSA) ─────────────────────────────────────────────
+   snd_seq_subscribe_port can connect any two ports, not only our own, so a
+   route is a subscription from the external source straight to the external
+   destination. The kernel delivers events between them directly.            */
+
+static mm_result mm__alsa_route_addrs(mm_context* ctx, uint32_t in_idx,
+                                      uint32_t out_idx, mm__alsa_route* r)
+{
+    int client = -1, port = -1;
+    if (mm__alsa_walk(ctx, MM_PORT_INPUT, in_idx, &client, &port, NULL, 0) <= in_idx)
+        return MM_OUT_OF_RANGE;
+    r->sender.client = (unsigned char)client;
+    r->sender.port   = (unsigned char)port;
+    return mm__alsa_out_addr(ctx, out_idx, &r->dest);
+}
+
+mm_result mm_route_connect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx,
+                           const mm_route_options* opts)
+{
+    if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    mm__ctx_alsa* al = &ctx->al;
+    mm__alsa_route r;
+    mm_result res = mm__alsa_route_addrs(ctx, in_idx, out_idx, &r);
+    if (res != MM_SUCCESS) return res;
+    res = mm__route_reserve(ctx, (void**)&al->routes, al->route_count,
+                            &al->route_cap, sizeof(mm__alsa_route));
+    if (res != MM_SUCCESS) return res;
+
+    uint32_t flags = opts ? opts->flags : 0;
+    int      queue = -1;
+    if (flags & (MM_ROUTE_TIMESTAMP|MM_ROUTE_TIMESTAMP_REAL)) {
+        queue = opts->queue;
+        if (queue < 0 && (queue = mm__alsa_ctx_queue(al, ctx->name)) < 0) return MM_ERROR;
+    }
+
+    snd_seq_port_subscribe_t* sub;
+    snd_seq_port_subscribe_alloca(&sub);
+    snd_seq_port_subscribe_set_sender(sub, &r.sender);
+    snd_seq_port_subscribe_set_dest(sub, &r.dest);
+    snd_seq_port_subscribe_set_exclusive(sub, (flags & MM_ROUTE_EXCLUSIVE) ? 1 : 0);
+    if (queue >= 0) {
+        snd_seq_port_subscribe_set_queue(sub, queue);
+        snd_seq_port_subscribe_set_time_update(sub, 1);
+        snd_seq_port_subscribe_set_time_real(sub,
+            (flags & MM_ROUTE_TIMESTAMP_REAL) ? 1 : 0);
+    }
+    int rc = snd_seq_subscribe_port(al->seq, sub);
+    if (rc == -EBUSY) return MM_ALREADY_OPEN;
+    if (rc < 0)       return MM_ERROR;
+    al->routes[al->route_count++] = r;
+    return MM_SUCCESS;
+}
+
+mm_result mm_route_disconnect(mm_context* ctx, uint32_t in_idx, uint32_t out_idx)
+{
+    if (!ctx||!ctx->initialized) return MM_INVALID_ARG;
+    mm__ctx_alsa* al = &ctx->al;
+    mm__alsa_route r;
+    mm_result res = mm__alsa_route_addrs(ctx, in_idx, out_idx, &r);
+    if (res != MM_SUCCESS) return res;
+    for (uint32_t i = 0; i < al->route_count; i++) {
+        mm__alsa_route* x = &al->routes[i];
+        if (x->sender.client != r.sender.client || x->sender.port != r.sender.port ||
+            x->dest.client   != r.dest.client   || x->dest.port   != r.dest.port)
+            continue;
+        mm__alsa_unsubscribe(al, x);
+        al->routes[i] = al->routes[--al->route_count];
+        return MM_SUCCESS;
+    }
+    return MM_NOT_OPEN;
+}
+
 /* ── Virtual ports (ALSA) ──────────────────────────────────────────────────
    On ALSA, the difference between a normal and virtual port is just capability
    flags and whether we call snd_seq_connect_from/to ourselves.
@@ -1429,20 +5639,48 @@ mm_result mm_in_open_virtual(mm_context* ctx, mm_device* dev,
     dev->ctx=ctx; dev->callback=cb; dev->userdata=ud;
     dev->is_input=1; dev->is_virtual=1;
 
-    if (pipe(dev->al.wake_pipe) != 0) return MM_ERROR;
-
     /* Port name is just the client name — no "-in" suffix for virtual ports,
        since the client name already identifies the app uniquely.              */
     dev->al.port_id = snd_seq_create_simple_port(ctx->al.seq, ctx->name,
         SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
         SND_SEQ_PORT_TYPE_APPLICATION | SND_SEQ_PORT_TYPE_MIDI_GENERIC);
-    if (dev->al.port_id < 0) {
-        close(dev->al.wake_pipe[0]); close(dev->al.wake_pipe[1]); return MM_ERROR;
+    if (dev->al.port_id < 0) return MM_ERROR;
+    dev->is_open=1; return MM_SUCCESS;
+}
+
+/* Multi-port virtual input: N ports on the context handle, all mapped to one
+   device in the dispatcher table, so one thread services every port.       */
+mm_result mm_in_open_virtual_multi(mm_context* ctx, mm_device* dev,
+                                   const char* const* names, uint32_t count,
+                                   mm_callback cb, void* ud)
+{
+    if (!ctx||!ctx->initialized||!dev||!cb||!count||count > 0xFFFF) return MM_INVALID_ARG;
+    memset(dev,0,sizeof(*dev));
+    dev->ctx=ctx; dev->callback=cb; dev->userdata=ud;
+    dev->is_input=1; dev->is_virtual=1;
+
+    dev->al.vports = (mm__alsa_vport*)mm__calloc(ctx, count, sizeof(mm__alsa_vport));
+    if (!dev->al.vports) return MM_ALLOC_FAILED;
+    for (uint32_t i = 0; i < count; i++) {
+        char name[80];
+        if (names && names[i]) snprintf(name, sizeof(name), "%s", names[i]);
+        else                   snprintf(name, sizeof(name), "%s-%u", ctx->name, i + 1);
+        int id = snd_seq_create_simple_port(ctx->al.seq, name,
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+            SND_SEQ_PORT_TYPE_APPLICATION | SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+        if (id < 0) {
+            while (i--) snd_seq_delete_port(ctx->al.seq, dev->al.vports[i].port_id);
+            mm__free(ctx, dev->al.vports); dev->al.vports = NULL;
+            return MM_ERROR;
+        }
+        dev->al.vports[i].port_id = id;
+        dev->al.vport_count = i + 1;
     }
+    dev->al.port_id = dev->al.vports[0].port_id;
     dev->is_open=1; return MM_SUCCESS;
 }
 
-/* mm_in_start for virtual ALSA: just launch the recv thread.
+/* mm_in_start for virtual ALSA: just register with the dispatcher.
    No explicit connect — other apps connect to us.                            */
 /* mm_in_start / mm_in_stop / mm_in_close are already defined above and
    handle the virtual case: stop skips snd_seq_disconnect_from when virtual. */
@@ -1463,6 +5701,403 @@ mm_result mm_out_open_virtual(mm_context* ctx, mm_device* dev)
 
 #endif /* ALSA backend */
 
+#if !defined(MM_BACKEND_ALSA)
+/* The clock master needs a queue that retimes scheduled clocks on a tempo
+   change. WinMM sends at once and a CoreMIDI packet's time is fixed once
+   sent, so elsewhere every call returns MM_NO_BACKEND.                     */
+mm_result mm_clock_master_init(mm_clock_master* m, mm_device* out, double bpm) {
+    (void)out; (void)bpm;
+    if (m) { memset(m, 0, sizeof(*m)); m->queue = -1; }
+    return MM_NO_BACKEND;
+}
+mm_result mm_clock_master_uninit   (mm_clock_master* m) { (void)m; return MM_NO_BACKEND; }
+mm_result mm_clock_master_start    (mm_clock_master* m) { (void)m; return MM_NO_BACKEND; }
+mm_result mm_clock_master_continue (mm_clock_master* m) { (void)m; return MM_NO_BACKEND; }
+mm_result mm_clock_master_stop     (mm_clock_master* m) { (void)m; return MM_NO_BACKEND; }
+mm_result mm_clock_master_refill   (mm_clock_master* m) { (void)m; return MM_NO_BACKEND; }
+mm_result mm_clock_master_locate(mm_clock_master* m, uint16_t song_position) {
+    (void)m; (void)song_position; return MM_NO_BACKEND;
+}
+mm_result mm_clock_master_set_tempo(mm_clock_master* m, double bpm) {
+    (void)m; (void)bpm; return MM_NO_BACKEND;
+}
+#endif
+
+/* ─────────────────────────────────────────────────────────────────────────────
+   UMP I/O — shared by all backends
+   Without a UMP client, input is translated from each mm_message by a shim
+   installed as the device's mm_callback, and output is decoded back into
+   mm_out_send / mm_out_send_sysex calls.
+   ───────────────────────────────────────────────────────────────────────── */
+
+int mm_context_is_ump(const mm_context* ctx) {
+#ifdef MM__ALSA_UMP
+    return ctx && ctx->initialized && ctx->al.ump != 0;
+#else
+    (void)ctx; return 0;
+#endif
+}
+
+static mm_ump_protocol mm__ump_protocol(const mm_context* ctx) {
+    return ctx->config.ump == MM_UMP_PROTOCOL_MIDI2 ? MM_UMP_PROTOCOL_MIDI2
+                                                     : MM_UMP_PROTOCOL_MIDI1;
+}
+
+static void mm__ump_shim(mm_device* dev, const mm_message* msg, void* ud) {
+    (void)ud;
+    uint32_t w[2];
+    const uint32_t group = msg->port_index & 0x0F;
+    if (msg->type != MM_SYSEX) {
+        size_t n = mm__ump_short(msg, mm__ump_protocol(dev->ctx), group, w);
+        if (n) dev->ump_callback(dev, w, (uint32_t)n, msg->timestamp, dev->ump_userdata);
+        return;
+    }
+    /* SysEx: one packet per call, like a UMP client would deliver it. */
+    size_t len;
+    const uint8_t* d = mm__ump_sysex_body(msg, &len);
+    size_t packets = len ? (len + 5) / 6 : 1;
+    for (size_t k = 0; k < packets; k++) {
+        unsigned chunk = (unsigned)(len - 6 * k < 6 ? len - 6 * k : 6);
+        uint32_t status = packets == 1 ? MM_UMP_SYSEX_COMPLETE
+                        : k == 0       ? MM_UMP_SYSEX_START
+                        : k + 1 == packets ? MM_UMP_SYSEX_END : MM_UMP_SYSEX_CONTINUE;
+        mm__ump_sysex_packet(group, status, d + 6 * k, chunk, w);
+        dev->ump_callback(dev, w, 2, msg->timestamp, dev->ump_userdata);
+    }
+}
+
+mm_result mm_in_set_ump_callback(mm_device* dev, mm_ump_callback cb, void* userdata) {
+    if (!dev||!dev->is_open||!dev->is_input) return MM_NOT_OPEN;
+    if (!cb) return MM_INVALID_ARG;
+    dev->ump_callback = cb;
+    dev->ump_userdata = userdata;
+    if (!mm_context_is_ump(dev->ctx)) dev->callback = mm__ump_shim;
+    return MM_SUCCESS;
+}
+
+typedef struct mm__ump_send_state { mm_device* dev; mm_result res; } mm__ump_send_state;
+
+static void mm__ump_send_emit(const mm_message* msg, void* ud) {
+    mm__ump_send_state* s = (mm__ump_send_state*)ud;
+    mm_result r = (msg->type == MM_SYSEX)
+                ? mm_out_send_sysex(s->dev, msg->sysex, msg->sysex_size)
+                : mm_out_send(s->dev, msg);
+    if (s->res == MM_SUCCESS) s->res = r;
+}
+
+mm_result mm_out_send_ump(mm_device* dev, const uint32_t* words, size_t n) {
+    if (!dev||!dev->is_open||dev->is_input) return MM_NOT_OPEN;
+    if (!words && n) return MM_INVALID_ARG;
+#ifdef MM__ALSA_UMP
+    if (dev->ctx->al.ump) return mm__alsa_send_ump(dev, words, n);
+#endif
+    size_t i = 0;
+    while (i < n) i += mm_ump_words(words[i]);
+    if (i != n) return MM_INVALID_ARG;
+    /* SysEx7 spanning calls is assembled here, in sysex_size bytes. */
+    if (!dev->ump_out) {
+        const size_t cap = dev->ctx->config.sysex_size;
+        dev->ump_out = (mm_ump_decoder*)mm__calloc(dev->ctx, 1, sizeof(mm_ump_decoder) + cap);
+        if (!dev->ump_out) return MM_ALLOC_FAILED;
+        mm_ump_decoder_init(dev->ump_out, (uint8_t*)(dev->ump_out + 1), cap);
+    }
+    mm__ump_send_state st = { dev, MM_SUCCESS };
+    mm_ump_decode(dev->ump_out, words, n, mm__ump_send_emit, &st);
+    return st.res;
+}
+
+static void mm__ump_release(mm_device* dev) {
+    mm__free(dev->ctx, dev->ump_out);
+    dev->ump_out = NULL;
+}
+
+/* ─────────────────────────────────────────────────────────────────────────────
+   Port registry — shared by all backends
+   ───────────────────────────────────────────────────────────────────────── */
+
+/* Copy the names still in use into the spare buffer, back to back, and
+   swap the two: renamed and removed ports leave their old names behind.   */
+static void mm__registry_compact(mm_port_registry* reg) {
+    size_t at = 0;
+    for (uint32_t i = 0; i < reg->count; i++) {
+        size_t n = strlen(reg->ports[i].name) + 1;
+        memcpy(reg->names_spare + at, reg->ports[i].name, n);
+        reg->ports[i].name = reg->names_spare + at;
+        at += n;
+    }
+    char* t = reg->names; reg->names = reg->names_spare; reg->names_spare = t;
+    reg->names_size = at;
+}
+
+/* Names are interned into one buffer. ports[].name points into it, so when
+   it moves every name pointer is rebased before the old one is released.
+   A full buffer is compacted first and only grows if that is not enough,
+   so hotplug churn cannot grow it without bound.                          */
+static mm_result mm__registry_intern(mm_port_registry* reg, const char* str,
+                                     const char** out)
+{
+    size_t len = strlen(str) + 1;
+    if (reg->names_size + len > reg->names_cap && reg->names_spare) {
+        mm__registry_compact(reg);
+    }
+    if (reg->names_size + len > reg->names_cap) {
+        if (reg->fixed) return MM_ALLOC_FAILED;
+        size_t cap = reg->names_cap ? reg->names_cap : 1024;
+        while (cap < reg->names_size + len) cap *= 2;
+        char* names = (char*)mm__malloc(reg->ctx, cap);
+        char* spare = (char*)mm__malloc(reg->ctx, cap);
+        if (!names || !spare) {
+            mm__free(reg->ctx, names); mm__free(reg->ctx, spare);
+            return MM_ALLOC_FAILED;
+        }
+        if (reg->names_size) memcpy(names, reg->names, reg->names_size);
+        for (uint32_t i = 0; i < reg->count; i++)
+            reg->ports[i].name = names + (reg->ports[i].name - reg->names);
+        mm__free(reg->ctx, reg->names); mm__free(reg->ctx, reg->names_spare);
+        reg->names = names; reg->names_spare = spare; reg->names_cap = cap;
+    }
+    char* dst = reg->names + reg->names_size;
+    memcpy(dst, str, len);
+    reg->names_size += len;
+    *out = dst;
+    return MM_SUCCESS;
+}
+
+static mm_result mm__registry_insert(mm_port_registry* reg, uint32_t pos,
+                                     const char* name, int client, int port,
+                                     uint32_t flags, uint32_t caps, uint32_t type)
+{
+    if (reg->count == reg->capacity) {
+        if (reg->fixed) return MM_ALLOC_FAILED;
+        uint32_t cap = reg->capacity ? reg->capacity * 2 : 32;
+        mm_port_info* p = (mm_port_info*)mm__realloc(reg->ctx, reg->ports, cap * sizeof(*p));
+        if (!p) return MM_ALLOC_FAILED;
+        reg->ports = p; reg->capacity = cap;
+    }
+    const char* interned;
+    if (mm__registry_intern(reg, name, &interned) != MM_SUCCESS) return MM_ALLOC_FAILED;
+    if (pos < reg->count)
+        memmove(&reg->ports[pos+1], &reg->ports[pos],
+                (reg->count - pos) * sizeof(mm_port_info));
+    mm_port_info* pi = &reg->ports[pos];
+    pi->name   = interned;
+    pi->client = client; pi->port = port;
+    pi->flags  = flags;  pi->caps = caps; pi->type = type;
+    reg->count++;
+    return MM_SUCCESS;
+}
+
+static mm_result mm__registry_add(mm_port_registry* reg, const char* name,
+                                  int client, int port, uint32_t flags,
+                                  uint32_t caps, uint32_t type)
+{
+    return mm__registry_insert(reg, reg->count, name, client, port, flags, caps, type);
+}
+
+/* Drops the entry; its name bytes stay in the pool until it is compacted. */
+static void mm__registry_remove(mm_port_registry* reg, uint32_t pos) {
+    if (pos >= reg->count) return;
+    memmove(&reg->ports[pos], &reg->ports[pos+1],
+            (reg->count - pos - 1) * sizeof(mm_port_info));
+    reg->count--;
+}
+
+/* Binary search by client:port (the order enumeration produces). Returns 1 and
+   the index if present, else 0 and the index where it would be inserted.    */
+static int mm__registry_find(const mm_port_registry* reg, int client, int port,
+                             uint32_t* pos)
+{
+    uint32_t lo = 0, hi = reg->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const mm_port_info* p = &reg->ports[mid];
+        if (p->client < client || (p->client == client && p->port < port)) lo = mid + 1;
+        else hi = mid;
+    }
+    *pos = lo;
+    return lo < reg->count && reg->ports[lo].client == client && reg->ports[lo].port == port;
+}
+
+/* Rebuild the in/out index maps from ports[]. The maps only grow, so a
+   hotplug event that does not add capacity does not allocate.             */
+static mm_result mm__registry_index(mm_port_registry* reg) {
+    reg->in_count = reg->out_count = 0;
+    if (reg->count > reg->index_cap) {
+        if (reg->fixed) return MM_ALLOC_FAILED;
+        uint32_t* in  = (uint32_t*)mm__realloc(reg->ctx, reg->in,  reg->capacity * sizeof(uint32_t));
+        if (in) reg->in = in;
+        uint32_t* out = (uint32_t*)mm__realloc(reg->ctx, reg->out, reg->capacity * sizeof(uint32_t));
+        if (out) reg->out = out;
+        if (!in || !out) return MM_ALLOC_FAILED;
+        reg->index_cap = reg->capacity;
+    }
+    for (uint32_t i = 0; i < reg->count; i++) {
+        if (reg->ports[i].flags & MM_PORT_INPUT)  reg->in [reg->in_count++]  = i;
+        if (reg->ports[i].flags & MM_PORT_OUTPUT) reg->out[reg->out_count++] = i;
+    }
+    return MM_SUCCESS;
+}
+
+/* ── Bulk open (portable parts) ────────────────────────────────────────────
+   Registry entries already carry their address, so there is nothing to
+   resolve; CoreMIDI and WinMM index lookups are O(1), so their bulk open is
+   a plain loop over the single-device calls.                               */
+
+mm_result mm_in_open_many_ports(mm_context* ctx, mm_device* devs,
+                                const mm_port_info* const* ports, uint32_t count,
+                                mm_callback cb, void* ud, mm_result* results)
+{
+    if (!ctx||!devs||!ports||!cb) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_in_open_port(ctx, &devs[i], ports[i], cb, ud);
+        if (r != MM_SUCCESS) devs[i].is_open = 0;
+        if (results) results[i] = r;
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+
+mm_result mm_out_open_many_ports(mm_context* ctx, mm_device* devs,
+                                 const mm_port_info* const* ports, uint32_t count,
+                                 mm_result* results)
+{
+    if (!ctx||!devs||!ports) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_out_open_port(ctx, &devs[i], ports[i]);
+        if (r != MM_SUCCESS) devs[i].is_open = 0;
+        if (results) results[i] = r;
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+
+#if !defined(MM_BACKEND_ALSA)
+mm_result mm_in_open_many(mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                          uint32_t count, mm_callback cb, void* ud, mm_result* results)
+{
+    if (!ctx||!devs||!idx||!cb) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_in_open(ctx, &devs[i], idx[i], cb, ud);
+        if (r != MM_SUCCESS) devs[i].is_open = 0;
+        if (results) results[i] = r;
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+
+mm_result mm_out_open_many(mm_context* ctx, mm_device* devs, const uint32_t* idx,
+                           uint32_t count, mm_result* results)
+{
+    if (!ctx||!devs||!idx) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_out_open(ctx, &devs[i], idx[i]);
+        if (r != MM_SUCCESS) devs[i].is_open = 0;
+        if (results) results[i] = r;
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+
+mm_result mm_in_start_many(mm_device* devs, uint32_t count) {
+    if (!devs) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_in_start(&devs[i]);
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+
+mm_result mm_in_stop_many(mm_device* devs, uint32_t count) {
+    if (!devs) return MM_INVALID_ARG;
+    mm_result res = MM_SUCCESS;
+    for (uint32_t i = 0; i < count; i++) {
+        mm_result r = mm_in_stop(&devs[i]);
+        if (r != MM_SUCCESS && res == MM_SUCCESS) res = r;
+    }
+    return res;
+}
+#endif
+
+mm_result mm_registry_init(mm_context* ctx, mm_port_registry* reg) {
+    if (!ctx||!ctx->initialized||!reg) return MM_INVALID_ARG;
+    memset(reg, 0, sizeof(*reg));
+    reg->ctx = ctx;
+    return mm_registry_refresh(reg);
+}
+
+/* Room for `ports` entries and `names` name bytes, so hotplug updates on the
+   watch thread fit without allocating. Index maps follow capacity.        */
+static mm_result mm__registry_reserve(mm_port_registry* reg, uint32_t ports, size_t names) {
+    if (ports > reg->capacity) {
+        mm_port_info* p = (mm_port_info*)mm__realloc(reg->ctx, reg->ports, ports * sizeof(*p));
+        if (!p) return MM_ALLOC_FAILED;
+        reg->ports = p; reg->capacity = ports;
+    }
+    if (reg->capacity > reg->index_cap) {
+        uint32_t* in  = (uint32_t*)mm__realloc(reg->ctx, reg->in,  reg->capacity * sizeof(uint32_t));
+        if (in) reg->in = in;
+        uint32_t* out = (uint32_t*)mm__realloc(reg->ctx, reg->out, reg->capacity * sizeof(uint32_t));
+        if (out) reg->out = out;
+        if (!in || !out) return MM_ALLOC_FAILED;
+        reg->index_cap = reg->capacity;
+    }
+    if (names > reg->names_cap) {
+        char* n = (char*)mm__malloc(reg->ctx, names);
+        char* sp = (char*)mm__malloc(reg->ctx, names);
+        if (!n || !sp) { mm__free(reg->ctx, n); mm__free(reg->ctx, sp); return MM_ALLOC_FAILED; }
+        if (reg->names_size) memcpy(n, reg->names, reg->names_size);
+        for (uint32_t i = 0; i < reg->count; i++)
+            reg->ports[i].name = n + (reg->ports[i].name - reg->names);
+        mm__free(reg->ctx, reg->names); mm__free(reg->ctx, reg->names_spare);
+        reg->names = n; reg->names_spare = sp; reg->names_cap = names;
+    }
+    return MM_SUCCESS;
+}
+
+mm_result mm_registry_refresh(mm_port_registry* reg) {
+    if (!reg||!reg->ctx||!reg->ctx->initialized) return MM_INVALID_ARG;
+    mm_registry_lock(reg);
+    reg->count = 0; reg->names_size = 0;   /* keep the storage, drop contents */
+    mm_result res = mm__registry_enum(reg);
+    if (res == MM_SUCCESS)
+        res = mm__registry_reserve(reg, reg->count + MM_REGISTRY_RESERVE,
+                                   reg->names_size + (size_t)MM_REGISTRY_RESERVE * 64);
+    if (res == MM_SUCCESS) res = mm__registry_index(reg);
+    if (res != MM_SUCCESS) { reg->count = reg->in_count = reg->out_count = 0; }
+    mm_registry_unlock(reg);
+    return res;
+}
+
+void mm_registry_uninit(mm_port_registry* reg) {
+    if (!reg) return;
+    if (reg->watching) mm_registry_unwatch(reg);
+    if (reg->ctx) {
+        mm__free(reg->ctx, reg->ports); mm__free(reg->ctx, reg->in);
+        mm__free(reg->ctx, reg->out);   mm__free(reg->ctx, reg->names);
+        mm__free(reg->ctx, reg->names_spare);
+    }
+    memset(reg, 0, sizeof(*reg));
+}
+
+const mm_port_info* mm_registry_in(const mm_port_registry* reg, uint32_t idx) {
+    if (!reg || idx >= reg->in_count) return NULL;
+    return &reg->ports[reg->in[idx]];
+}
+const mm_port_info* mm_registry_out(const mm_port_registry* reg, uint32_t idx) {
+    if (!reg || idx >= reg->out_count) return NULL;
+    return &reg->ports[reg->out[idx]];
+}
+const mm_port_info* mm_registry_find(const mm_port_registry* reg, int client, int port) {
+    uint32_t pos;
+    if (!reg || client < 0 || port < 0) return NULL;
+    return mm__registry_find(reg, client, port, &pos) ? &reg->ports[pos] : NULL;
+}
+
 #endif /* MINIMIDIO_IMPLEMENTATION */
 
 #ifdef __cplusplus